@@ -0,0 +1,451 @@
+// Benchmarks of each stage of parsing (scanning, indexing tokens, parsing into a map and converting values), of the
+// error path, of validating batches of command lines on several threads and of rendering help, over synthetic commands
+// and command lines of growing size. Each case reports the time per run and per token (i.e. per argument in the command
+// line), the allocations per run and the peak RSS of the process so far.
+//
+// Usage: bench [filter] [--min-time=<ms>]
+//   filter      only run the cases whose name contains it, e.g. `scan/` or `tokens=1000000`
+//   --min-time  how long each case is repeated for at least (200ms by default)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <fmt/format.h>
+
+#include "opzioni/batch.hpp"
+#include "opzioni/cmd.hpp"
+#include "opzioni/converters.hpp"
+#include "opzioni/scanner.hpp"
+
+// +--------------------------------+
+// |      counting allocations      |
+// +--------------------------------+
+
+namespace {
+
+// atomic since the batch cases allocate from several threads
+std::atomic<std::size_t> allocations{0};
+
+[[nodiscard]] void *counted_alloc(std::size_t const size, std::size_t const alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  auto const rounded_size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+  void *const ptr = alignment <= alignof(std::max_align_t) ? std::malloc(rounded_size)
+                                                           : std::aligned_alloc(alignment, rounded_size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+} // namespace
+
+void *operator new(std::size_t const size) { return counted_alloc(size, alignof(std::max_align_t)); }
+void *operator new(std::size_t const size, std::align_val_t const alignment) {
+  return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void *const ptr) noexcept { std::free(ptr); }
+void operator delete(void *const ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *const ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *const ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+
+// +--------------------------------+
+// |            harness             |
+// +--------------------------------+
+
+struct Options {
+  std::string_view filter;
+  std::chrono::nanoseconds min_time{std::chrono::milliseconds(200)};
+};
+
+Options options;
+
+// Keeps the compiler from optimizing away the computation of `value`
+template <typename T>
+void keep(T const &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// `value` as if it weren't known at compile time, so that what is computed from it isn't folded into a constant
+[[nodiscard]] std::string_view opaque(std::string_view const value) {
+  auto const *data = value.data();
+  asm volatile("" : "+r"(data));
+  return {data, value.size()};
+}
+
+[[nodiscard]] double peak_rss_mib() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024; // in KiB on Linux
+}
+
+// Runs `run` in batches of doubling size until `options.min_time` has passed, after a first run to warm up (e.g. so
+// that memory that is reused across runs is already there)
+template <typename Run>
+void bench(std::string const &name, std::size_t const tokens, Run const &run) {
+  if (!name.contains(options.filter)) return;
+  run();
+  using clock = std::chrono::steady_clock;
+  std::size_t runs = 0;
+  auto const allocations_before = allocations.load();
+  auto const start = clock::now();
+  auto elapsed = clock::duration::zero();
+  for (std::size_t batch = 1; elapsed < options.min_time; batch *= 2) {
+    for (std::size_t i = 0; i < batch; ++i) {
+      run();
+    }
+    runs += batch;
+    elapsed = clock::now() - start;
+  }
+  auto const ns_per_run = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(runs);
+  auto const allocs_per_run = static_cast<double>(allocations.load() - allocations_before) / static_cast<double>(runs);
+  fmt::print(
+    "{:<40} {:>12.1f} {:>10.2f} {:>12.1f} {:>10.1f}\n",
+    name,
+    ns_per_run,
+    ns_per_run / static_cast<double>(std::max<std::size_t>(tokens, 1)),
+    allocs_per_run,
+    peak_rss_mib()
+  );
+  std::fflush(stdout);
+}
+
+// +--------------------------------+
+// |       synthetic commands       |
+// +--------------------------------+
+
+// Name of the `idx`th synthetic option, e.g. `o0042`
+[[nodiscard]] constexpr opz::FixedString<5> opt_name(std::size_t const idx) noexcept {
+  char const name[] = {
+    'o',
+    static_cast<char>('0' + idx / 1000 % 10),
+    static_cast<char>('0' + idx / 100 % 10),
+    static_cast<char>('0' + idx / 10 % 10),
+    static_cast<char>('0' + idx % 10),
+    '\0',
+  };
+  return opz::FixedString<5>(name);
+}
+
+// A command with `N` options named by `opt_name` whose only subcommand `s` (if `depth > 1`) is another such command,
+// described straight by its CmdSchema. That's all that scanning and indexing look at, and it can have far more
+// arguments than a `Cmd` would with reasonable compile times.
+template <std::size_t N>
+class SchemaCmd {
+public:
+
+  explicit SchemaCmd(std::size_t const depth)
+    : names(make_names()),
+      lookup(opz::make_arg_lookup<N>(this->names, {})),
+      schema{
+        .lookup = this->lookup.view(),
+        .kinds = this->kinds,
+        .find_subcmd = &SchemaCmd::find_subcmd,
+        .get_subcmd = &SchemaCmd::get_subcmd,
+      },
+      sub(depth > 1 ? std::make_unique<SchemaCmd>(depth - 1) : nullptr) {
+    this->kinds.fill(opz::ArgKind::OPT);
+  }
+
+  // the schema points into the command
+  SchemaCmd(SchemaCmd const &) = delete;
+  SchemaCmd &operator=(SchemaCmd const &) = delete;
+
+  [[nodiscard]] opz::CmdRef ref() const noexcept { return {this, &this->schema}; }
+
+private:
+
+  std::string name_chars;
+  std::array<std::string_view, N> names;
+  opz::ArgLookup<N> lookup;
+  std::array<opz::ArgKind, N> kinds;
+  opz::CmdSchema schema;
+  std::unique_ptr<SchemaCmd> sub;
+
+  [[nodiscard]] std::array<std::string_view, N> make_names() {
+    this->name_chars.reserve(N * 5);
+    for (std::size_t i = 0; i < N; ++i) {
+      this->name_chars += std::string_view(opt_name(i));
+    }
+    std::array<std::string_view, N> views;
+    for (std::size_t i = 0; i < N; ++i) {
+      views[i] = std::string_view(this->name_chars).substr(i * 5, 5);
+    }
+    return views;
+  }
+
+  static int find_subcmd(void const *cmd, std::string_view const name) noexcept {
+    return static_cast<SchemaCmd const *>(cmd)->sub != nullptr && name == "s" ? 0 : -1;
+  }
+
+  static opz::CmdRef get_subcmd(void const *cmd, int) noexcept {
+    return static_cast<SchemaCmd const *>(cmd)->sub->ref();
+  }
+};
+
+template <std::size_t I>
+struct OptAt {};
+
+// Adds the `I`th synthetic option to `cmd`, so that a fold over `|` adds many of them
+template <opz::concepts::Cmd Cmd, std::size_t I>
+consteval auto operator|(Cmd const &cmd, OptAt<I>) {
+  return cmd.template opt<opt_name(I), "", std::vector<int>, opz::act::append>({});
+}
+
+// A `Cmd` with `sizeof...(Is)` options named by `opt_name`, all appending integers
+template <std::size_t... Is>
+consteval auto make_opts_cmd(std::index_sequence<Is...>) {
+  return (opz::new_cmd("prog") | ... | OptAt<Is>{}).template flg<"help", "h">(opz::default_help);
+}
+
+// Every option of a `Cmd` adds to its compile time (more so than to its run time, and GCC runs out of memory well
+// before 100 of them), so the parser is measured on small commands and on deep ones, while scanning and indexing are
+// measured with many more options on `SchemaCmd`
+constexpr auto opts_cmd = make_opts_cmd(std::make_index_sequence<10>());
+constexpr auto more_opts_cmd = make_opts_cmd(std::make_index_sequence<32>());
+constexpr auto lazy_opts_cmd = [] consteval {
+  auto cmd = opts_cmd;
+  return cmd.with({.lazy_conversion = true});
+}();
+
+// A `Cmd` with an option `num` whose subcommand `s` is the same, `Depth` commands deep
+template <std::size_t Depth>
+consteval auto make_nested_cmd();
+
+template <std::size_t Depth>
+constexpr auto nested_cmd = make_nested_cmd<Depth>();
+
+template <std::size_t Depth>
+consteval auto make_nested_cmd() {
+  auto const cmd = opz::new_cmd("s").opt<"num", "N", std::vector<int>, opz::act::append>({});
+  if constexpr (Depth == 1) return cmd;
+  else return cmd.sub(nested_cmd<Depth - 1>);
+}
+
+// +--------------------------------+
+// |     synthetic command lines    |
+// +--------------------------------+
+
+// Arguments for a command made by `SchemaCmd` or `make_opts_cmd`, which are laid out back to back in a single block,
+// each followed by its NUL, with an array of C strings pointing into it, as the kernel lays out `argv` for `main`
+class Argv {
+public:
+
+  // `tokens` arguments: the program name, `--o0000=1 s` for each level of subcommands below the root command, and then
+  // options of the deepest one (cycling through `opts_count` of them) each followed by its value
+  Argv(std::size_t const opts_count, std::size_t const depth, std::size_t const tokens)
+    : Argv(tokens, [opts_count, depth, tokens](std::size_t const idx) -> std::string {
+        if (idx == 0) return "prog";
+        if (idx < 2 * depth - 1) return idx % 2 == 1 ? "--o0000=1" : "s";
+        auto const rel_idx = idx - (2 * depth - 1);
+        if (rel_idx % 2 == 1) return "7";
+        auto const name = opt_name(rel_idx / 2 % opts_count);
+        // with no room left for the value, it goes after `=`
+        auto const name_view = std::string_view(name);
+        return idx + 1 == tokens ? fmt::format("--{}=7", name_view) : fmt::format("--{}", name_view);
+      }) {}
+
+  template <typename ArgAt>
+  Argv(std::size_t const tokens, ArgAt const &arg_at) {
+    std::vector<std::size_t> offsets;
+    offsets.reserve(tokens);
+    for (std::size_t i = 0; i < tokens; ++i) {
+      offsets.push_back(this->block.size());
+      this->block += arg_at(i);
+      this->block.push_back('\0');
+    }
+    // only now that the block is done growing can there be pointers into it
+    this->argv.reserve(tokens);
+    for (auto const offset : offsets) {
+      this->argv.push_back(this->block.data() + offset);
+    }
+  }
+
+  [[nodiscard]] std::span<char const *> args() noexcept { return this->argv; }
+
+private:
+
+  std::string block;
+  std::vector<char const *> argv;
+};
+
+// Arguments for `nested_cmd<depth>`: `--num=1 s` for each level below the root command, and then `-N 1` until there are
+// `tokens` of them
+[[nodiscard]] Argv nested_argv(std::size_t const depth, std::size_t const tokens) {
+  return Argv(tokens, [depth, tokens](std::size_t const idx) -> std::string {
+    if (idx == 0) return "prog";
+    if (idx < 2 * depth - 1) return idx % 2 == 1 ? "--num=1" : "s";
+    if ((idx - (2 * depth - 1)) % 2 == 1) return "1";
+    return idx + 1 == tokens ? "-N1" : "-N";
+  });
+}
+
+constexpr std::size_t token_counts[] = {10, 100, 10'000, 1'000'000};
+
+// +--------------------------------+
+// |             cases              |
+// +--------------------------------+
+
+template <std::size_t N>
+void bench_scan_and_index(std::size_t const depth, std::span<std::size_t const> const counts) {
+  SchemaCmd<N> const cmd(depth);
+  opz::Scanner scanner;
+  for (auto const tokens : counts) {
+    Argv command_line(N, depth, tokens);
+    auto const params = fmt::format("opts={}/depth={}/tokens={}", N, depth, tokens);
+    // only taking the arguments in, i.e. finding where each one ends
+    bench(fmt::format("split/{}", params), tokens, [&] { scanner.reset(command_line.args(), cmd.ref()); });
+    bench(fmt::format("scan/{}", params), tokens, [&] {
+      scanner.reset(command_line.args(), cmd.ref());
+      keep(scanner());
+    });
+    // scanning last, with the same arguments, leaves the tokens in the scanner
+    scanner.reset(command_line.args(), cmd.ref());
+    auto const scanned = scanner();
+    bench(fmt::format("index/{}", params), tokens, [&] {
+      keep(opz::index_tokens(scanned, N, 0, scanned.size() - 1));
+    });
+  }
+}
+
+void bench_parse() {
+  for (auto const tokens : token_counts) {
+    Argv command_line(10, 1, tokens);
+    bench(fmt::format("parse/opts=10/tokens={}", tokens), tokens, [&] {
+      keep(opz::CmdParser(opts_cmd)(command_line.args()));
+    });
+    bench(fmt::format("parse/lazy/opts=10/tokens={}", tokens), tokens, [&] {
+      keep(opz::CmdParser(lazy_opts_cmd)(command_line.args()));
+    });
+    auto parser = opts_cmd.reusable_parser();
+    auto map = parser.new_map();
+    bench(fmt::format("parse/reusable/opts=10/tokens={}", tokens), tokens, [&] {
+      parser.parse_into(map, command_line.args());
+      keep(map);
+    });
+    Argv more_opts_command_line(32, 1, tokens);
+    bench(fmt::format("parse/opts=32/tokens={}", tokens), tokens, [&] {
+      keep(opz::CmdParser(more_opts_cmd)(more_opts_command_line.args()));
+    });
+  }
+  []<std::size_t... Depths>(std::index_sequence<Depths...>) {
+    (
+      [] {
+        constexpr auto depth = Depths + 1;
+        auto command_line = nested_argv(depth, 100);
+        bench(fmt::format("parse/depth={}/tokens=100", depth), 100, [&] {
+          keep(opz::CmdParser(nested_cmd<depth>)(command_line.args()));
+        });
+      }(),
+      ...
+    );
+  }(std::make_index_sequence<8>());
+}
+
+// Numbers as they were converted before `try_convert`, to compare against: integers with a single `std::from_chars`,
+// without checking that all of the value was consumed nor its range, and floats with `strtod`, which depends on the
+// locale and reads up to a NUL rather than to the end of the value
+namespace before_try_convert {
+
+[[nodiscard]] int convert_int(std::string_view const value) {
+  if (value.empty()) throw opz::ConversionError("empty string", "an integer type");
+  int integer = 0;
+  auto const conv_result = std::from_chars(value.data(), value.data() + value.size(), integer);
+  if (conv_result.ec == std::errc::invalid_argument) throw opz::ConversionError(value, "an integer type");
+  return integer;
+}
+
+[[nodiscard]] double convert_double(std::string_view const value) {
+  if (value.empty()) throw opz::ConversionError("empty string", "a floating point type");
+  char *end = nullptr;
+  double const floatnum = std::strtod(value.data(), &end);
+  if (errno == ERANGE || end == value.data()) throw opz::ConversionError(value, "a floating point type");
+  return floatnum;
+}
+
+} // namespace before_try_convert
+
+void bench_convert() {
+  bench("convert/int", 1, [] { keep(opz::convert<int>(opaque("-1234567"))); });
+  bench("convert/int/before", 1, [] { keep(before_try_convert::convert_int(opaque("-1234567"))); });
+  bench("convert/int/hex", 1, [] { keep(opz::convert<unsigned>(opaque("0x7fffabcd"))); });
+  bench("convert/double", 1, [] { keep(opz::convert<double>(opaque("-1234.5678e-3"))); });
+  bench("convert/double/before", 1, [] { keep(before_try_convert::convert_double(opaque("-1234.5678e-3"))); });
+  bench("convert/bool", 1, [] { keep(opz::convert<bool>(opaque("false"))); });
+  bench("convert/csv/8", 1, [] { keep(opz::convert<std::vector<int>>(opaque("1,2,3,4,5,6,7,8"))); });
+}
+
+void bench_errors() {
+  Argv unknown(4, [](std::size_t const idx) -> std::string { return idx == 0 ? "prog" : "--nope"; });
+  bench("error/unknown-arg", 4, [&] { keep(opts_cmd.try_parse(unknown.args())); });
+  Argv not_a_number(2, [](std::size_t const idx) -> std::string { return idx == 0 ? "prog" : "--o0001=x"; });
+  bench("error/conversion", 2, [&] { keep(opts_cmd.try_parse(not_a_number.args())); });
+  bench("error/conversion/formatted", 2, [&] {
+    auto const outcome = opts_cmd.try_parse(not_a_number.args());
+    fmt::memory_buffer out;
+    outcome.error().formatter.format_usage(out);
+    keep(out);
+  });
+}
+
+// The same batch of command lines validated with 1, 2, 4, ... threads, up to as many as the hardware supports
+void bench_batch() {
+  constexpr std::size_t lines = 10'000;
+  Argv command_line(10, 1, 10);
+  std::vector<std::span<char const *>> const argvs(lines, command_line.args());
+  auto const hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  for (unsigned threads = 1;; threads = std::min(threads * 2, hardware_threads)) {
+    bench(fmt::format("batch/threads={}/lines={}", threads, lines), lines * 10, [&] {
+      keep(opz::validate_batch(opts_cmd, argvs, {.threads = threads}));
+    });
+    if (threads == hardware_threads) break;
+  }
+}
+
+void bench_help() {
+  auto *const devnull = std::fopen("/dev/null", "w");
+  if (devnull == nullptr) return;
+  bench("help/opts=10", 0, [devnull] { opz::CmdFmt(opts_cmd, opz::ExtraInfo{}).print_help(devnull); });
+  bench("help/opts=32", 0, [devnull] { opz::CmdFmt(more_opts_cmd, opz::ExtraInfo{}).print_help(devnull); });
+  bench("help/depth=8", 0, [devnull] { opz::CmdFmt(nested_cmd<8>, opz::ExtraInfo{}).print_help(devnull); });
+  std::fclose(devnull);
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+  for (std::string_view const arg : std::span{argv, static_cast<std::size_t>(argc)}.subspan(1)) {
+    if (arg.starts_with("--min-time=")) options.min_time = std::chrono::milliseconds(std::atoi(arg.data() + 11));
+    else options.filter = arg;
+  }
+
+  fmt::print("{:<40} {:>12} {:>10} {:>12} {:>10}\n", "case", "ns/run", "ns/token", "allocs/run", "RSS MiB");
+  bench_scan_and_index<10>(1, token_counts);
+  bench_scan_and_index<100>(1, token_counts);
+  bench_scan_and_index<1000>(1, token_counts);
+  constexpr std::size_t depth_tokens[] = {10'000};
+  for (std::size_t depth = 2; depth <= 8; ++depth) {
+    bench_scan_and_index<10>(depth, depth_tokens);
+  }
+  bench_parse();
+  bench_convert();
+  bench_errors();
+  bench_batch();
+  bench_help();
+}
@@ -0,0 +1,55 @@
+// A command with `OPZIONI_BENCH_ARGS` arguments of a few kinds and types, which is parsed and looked into like a real
+// program would, so that compiling this file costs what a big CLI costs to compile (see compile_time.py)
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "opzioni/cmd.hpp"
+
+#ifndef OPZIONI_BENCH_ARGS
+#define OPZIONI_BENCH_ARGS 50
+#endif
+
+namespace {
+
+// Name of the `idx`th argument, e.g. `a0042`
+[[nodiscard]] constexpr opz::FixedString<5> arg_name(std::size_t const idx) noexcept {
+  char const name[] = {
+    'a',
+    static_cast<char>('0' + idx / 1000 % 10),
+    static_cast<char>('0' + idx / 100 % 10),
+    static_cast<char>('0' + idx / 10 % 10),
+    static_cast<char>('0' + idx % 10),
+    '\0',
+  };
+  return opz::FixedString<5>(name);
+}
+
+template <std::size_t I>
+struct ArgAt {};
+
+// Adds the `I`th argument to `cmd`, so that a fold over `|` adds many of them
+template <opz::concepts::Cmd Cmd, std::size_t I>
+consteval auto operator|(Cmd const &cmd, ArgAt<I>) {
+  if constexpr (I % 4 == 0) return cmd.template opt<arg_name(I), "", int>({.default_value = 0});
+  else if constexpr (I % 4 == 1) return cmd.template opt<arg_name(I), "", std::string_view>({.default_value = ""});
+  else if constexpr (I % 4 == 2) return cmd.template opt<arg_name(I), "", std::vector<double>, opz::act::csv>({});
+  else return cmd.template flg<arg_name(I)>({});
+}
+
+template <std::size_t... Is>
+consteval auto make_cmd(std::index_sequence<Is...>) {
+  return (opz::new_cmd("prog", "1.0") | ... | ArgAt<Is>{}).template flg<"help", "h">(opz::default_help);
+}
+
+constexpr auto cmd = make_cmd(std::make_index_sequence<OPZIONI_BENCH_ARGS>());
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+  auto const map = cmd(argc, argv);
+  fmt::print("{} {}\n", map.get<arg_name(0)>(), map.get<arg_name(OPZIONI_BENCH_ARGS - 1)>());
+}
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Measures how long compiling a command with many arguments takes, and how much memory the compiler needs for it.
+
+Usage: compile_time.py <build dir> <argument counts...>
+
+The compile command of benchmarks/compile_time.cpp is taken from the compile_commands.json of the build directory and
+run again for each argument count, so it has the same compiler and flags as the rest of the build.
+"""
+
+import json
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def compile_command(build_dir: str) -> tuple[list[str], str]:
+    with open(os.path.join(build_dir, 'compile_commands.json')) as f:
+        entries = json.load(f)
+    entry = next(e for e in entries if e['file'].endswith('compile_time.cpp'))
+    args = entry['arguments'] if 'arguments' in entry else shlex.split(entry['command'])
+    # the object file and the dependency file belong to the build, so they are left alone
+    command, skip_next = [], False
+    for arg in args:
+        if skip_next:
+            skip_next = False
+        elif arg in ('-o', '-MF', '-MQ', '-MT'):
+            skip_next = True
+        elif arg != '-MD' and not arg.startswith('-DOPZIONI_BENCH_ARGS='):
+            command.append(arg)
+    return command, entry['directory']
+
+
+def measure(command: list[str], directory: str, args_count: int) -> tuple[float, float]:
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        full_command = command + [f'-DOPZIONI_BENCH_ARGS={args_count}', '-o', os.path.join(tmp_dir, 'out.o')]
+        start = time.perf_counter()
+        process = subprocess.Popen(full_command, cwd=directory)
+        # the usage of the compiler driver includes the compiler proper that it waits for
+        _, status, usage = os.wait4(process.pid, 0)
+        seconds = time.perf_counter() - start
+        if os.waitstatus_to_exitcode(status) != 0:
+            sys.exit(f'compiling with {args_count} arguments failed')
+        return seconds, usage.ru_maxrss / 1024  # in KiB on Linux
+
+
+def main() -> None:
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    command, directory = compile_command(sys.argv[1])
+    print(f'{"arguments":>10} {"seconds":>10} {"peak MiB":>10}', flush=True)
+    for args_count in map(int, sys.argv[2:]):
+        seconds, peak_mib = measure(command, directory, args_count)
+        print(f'{args_count:>10} {seconds:>10.1f} {peak_mib:>10.0f}', flush=True)
+
+
+if __name__ == '__main__':
+    main()
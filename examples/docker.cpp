@@ -30,6 +30,7 @@ void handle_docker_subcmd(ArgsMap<decltype(exec_cmd)> const &map) {
 }
 
 constexpr static auto pull_cmd = new_cmd("pull")
+                                   .alias("fetch")
                                    .intro("Pull an image or a repository from a registry")
                                    .pos<"name">({.help = "The name of the image or repository to pull"})
                                    .flg<"all-tags", "a">({.help = "Download all tagged images in the repository"})
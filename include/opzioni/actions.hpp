@@ -3,7 +3,7 @@
 
 #include <format>
 #include <functional>
-#include <iostream>
+#include <memory_resource>
 #include <string_view>
 #include <variant>
 #include <vector>
@@ -20,8 +20,9 @@ namespace opz::act {
 
 using PosValueType = std::string_view;
 using FlgValueType = std::size_t;
-using OptValueType = std::reference_wrapper<std::vector<std::string_view> const>; // TODO: make it vector of optionals
-                                                                                  // to support implicit value
+using OptValueType = std::reference_wrapper<std::pmr::vector<std::string_view> const>; // TODO: make it vector of
+                                                                                       // optionals to support
+                                                                                       // implicit value
 using ArgValueTypes = TypeList<PosValueType, FlgValueType, OptValueType>;
 static constexpr auto pos_idx = IndexOfType<0, PosValueType, ArgValueTypes>::value;
 static constexpr auto flg_idx = IndexOfType<0, FlgValueType, ArgValueTypes>::value;
@@ -55,22 +56,19 @@ void consume_arg(
   ArgsMap<Cmd const> &args_map, Arg<C, act::append> const &arg, ArgValue const &value, Cmd const &, ExtraInfo const &
 ) {
   auto &target = std::get<TupleIdx>(args_map.args);
+  if (!target.has_value() && value.index() != flg_idx) target.emplace(args_map.template make_value<C>());
   std::visit(
     overloaded{
-      [&target](PosValueType sv) {
-        if (target.has_value()) target->emplace_back(convert<typename C::value_type>(sv));
-        else target.emplace(1, convert<typename C::value_type>(sv));
-      },
+      [&target](PosValueType sv) { target->emplace_back(convert<typename C::value_type>(sv)); },
       [&arg](FlgValueType flg_count) {
         throw std::logic_error(std::format("attempted to use a container type with flag `{}`", arg.name));
       },
       [&target](OptValueType vec) {
-        C converted_values;
+        if constexpr (requires { target->reserve(std::size_t{}); })
+          target->reserve(target->size() + vec.get().size());
         for (auto const v : vec.get()) {
-          converted_values.emplace_back(convert<typename C::value_type>(v));
+          target->emplace_back(convert<typename C::value_type>(v));
         }
-        if (target.has_value()) target->append_range(converted_values);
-        else target.emplace(std::from_range_t{}, converted_values);
       },
     },
     value
@@ -90,20 +88,26 @@ void consume_arg(
   std::get<TupleIdx>(args_map.args) = flg_amount;
 }
 
-template <int TupleIdx, concepts::Cmd Cmd, concepts::Container C>
+template <int TupleIdx, concepts::Cmd Cmd, concepts::Container C, char Delimiter, char Escape>
 void consume_arg(
-  ArgsMap<Cmd const> &args_map, Arg<C, act::csv> const &arg, ArgValue const &value, Cmd const &, ExtraInfo const &
+  ArgsMap<Cmd const> &args_map,
+  Arg<C, act::csv_with<Delimiter, Escape>> const &arg,
+  ArgValue const &value,
+  Cmd const &,
+  ExtraInfo const &
 ) {
   auto &target = std::get<TupleIdx>(args_map.args);
   std::visit(
     overloaded{
-      [&target](PosValueType sv) { target.emplace(std::from_range_t{}, convert<C>(sv)); },
+      [&args_map, &target](PosValueType sv) {
+        convert_into<Delimiter, Escape>(target.emplace(args_map.template make_value<C>()), sv);
+      },
       [&arg](FlgValueType) {
         throw std::logic_error(std::format("attempted to use the CSV action with flag `{}`", arg.name));
       },
-      [&target, &arg](OptValueType vec) {
+      [&args_map, &target, &arg](OptValueType vec) {
         if (vec.get().size() > 1) throw UnexpectedValue(arg.name, 1, vec.get().size());
-        target.emplace(std::from_range_t{}, convert<C>(vec.get()[0]));
+        convert_into<Delimiter, Escape>(target.emplace(args_map.template make_value<C>()), vec.get()[0]);
       },
     },
     value
@@ -115,30 +119,21 @@ void consume_arg(
   ArgsMap<Cmd const> &,
   Arg<bool, act::print_help> const &,
   ArgValue const &,
-  Cmd const &cmd,
+  Cmd const &,
   ExtraInfo const &extra_info
 ) {
-  CmdFmt const formatter(cmd, extra_info);
-  formatter.print_title();
-  if (!formatter.introduction.empty()) {
-    std::cout << nl;
-    formatter.print_intro();
-  }
-  std::cout << nl;
-  formatter.print_usage();
-  std::cout << nl;
-  formatter.print_help();
-  std::cout << nl;
-  formatter.print_details();
-  std::exit(0);
+  extra_info.exit_request = OutcomeKind::HELP;
 }
 
 template <int TupleIdx, concepts::Cmd Cmd>
 void consume_arg(
-  ArgsMap<Cmd const> &, Arg<bool, act::print_version> const &, ArgValue const &, Cmd const &cmd, ExtraInfo const &
+  ArgsMap<Cmd const> &,
+  Arg<bool, act::print_version> const &,
+  ArgValue const &,
+  Cmd const &,
+  ExtraInfo const &extra_info
 ) {
-  fmt::print("{} {}\n", cmd.name, cmd.version);
-  std::exit(0);
+  extra_info.exit_request = OutcomeKind::VERSION;
 }
 
 } // namespace opz::act
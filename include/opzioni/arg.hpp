@@ -1,12 +1,17 @@
 #ifndef OPZIONI_ARG_HPP
 #define OPZIONI_ARG_HPP
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string_view>
 
 #include "opzioni/concepts.hpp"
 #include "opzioni/fixed_string.hpp"
+#include "opzioni/strings.hpp"
 #include "opzioni/value_list.hpp"
 
 namespace opz {
@@ -18,6 +23,15 @@ enum struct ArgKind {
 };
 std::string_view to_string(ArgKind at) noexcept;
 
+// Where the value of an argument came from, in order of precedence
+enum struct ArgOrigin : std::uint8_t {
+  CMD_LINE,
+  ENV,
+  CONFIG_FILE,
+  DEFAULT,
+};
+std::string_view to_string(ArgOrigin origin) noexcept;
+
 // ArgKind specialization of ValueList
 template <ArgKind... AKs>
 using ArgKindList = ValueList<ArgKind, AKs...>;
@@ -37,10 +51,23 @@ namespace act {
 struct append {};
 struct assign {};
 struct count {};
-struct csv {};
 struct print_help {};
 struct print_version {};
 
+// Splits a value on `Delimiter` into the elements of a container. Unless `Escape` is `'\0'`, it makes the character
+// after it part of the element, e.g. a delimiter with `act::csv_with<';', '\\'>`.
+template <char Delimiter = ',', char Escape = '\0'>
+struct csv_with {
+  static constexpr char delimiter = Delimiter;
+  static constexpr char escape = Escape;
+};
+using csv = csv_with<>;
+
+template <typename>
+constexpr bool is_csv = false;
+template <char Delimiter, char Escape>
+constexpr bool is_csv<csv_with<Delimiter, Escape>> = true;
+
 } // namespace act
 
 // +---------------------------------+
@@ -53,6 +80,8 @@ struct ArgMeta {
   std::optional<bool> is_required{};
   std::optional<T> default_value{};
   std::optional<T> implicit_value{};
+  // environment variable that supplies a value if the argument is not in the command line
+  std::string_view env{};
 };
 
 constexpr static ArgMeta<bool, act::print_help> default_help = {
@@ -79,6 +108,11 @@ enum struct GroupKind {
   MUTUALLY_EXCLUSIVE,
 };
 
+// Allocator-aware types (e.g. `std::pmr::vector`) are not literal types, so commands can only hold empty optionals of
+// them. Their default (empty) value is constructed while parsing instead, using the memory resource of the ArgsMap.
+template <typename T>
+constexpr bool is_allocator_aware = std::uses_allocator_v<T, std::pmr::polymorphic_allocator<>>;
+
 template <typename T, typename Tag = act::assign>
 struct Arg {
   using value_type = T;
@@ -93,13 +127,67 @@ struct Arg {
   std::optional<T> implicit_value{};
   GroupKind grp_kind{GroupKind::NONE};
   std::uint_least32_t grp_id{0};
+  std::string_view env{};
 
   [[nodiscard]] constexpr bool has_abbrev() const noexcept { return !abbrev.empty(); }
-  [[nodiscard]] constexpr bool has_default() const noexcept { return default_value.has_value(); }
+  [[nodiscard]] constexpr bool has_default() const noexcept {
+    return default_value.has_value() || (is_allocator_aware<T> && kind != ArgKind::POS && !is_required);
+  }
   [[nodiscard]] constexpr bool has_implicit() const noexcept { return implicit_value.has_value(); }
   [[nodiscard]] constexpr bool has_group() const noexcept { return grp_kind != GroupKind::NONE; }
 };
 
+// +---------------------------------+
+// |             ArgDesc             |
+// +---------------------------------+
+
+// What parsing needs to know about an argument, which is everything in its Arg but its (typed) values. Commands keep
+// one per argument (see `Cmd::arg_descs`), built along with the command itself at compile time.
+struct ArgDesc {
+  ArgKind kind{ArgKind::POS};
+  std::string_view name{};
+  bool is_required{false};
+  bool has_default{false};
+  GroupKind grp_kind{GroupKind::NONE};
+  std::uint_least32_t grp_id{0};
+  std::string_view env{};
+
+  constexpr ArgDesc() = default;
+
+  template <typename T, typename Tag>
+  explicit constexpr ArgDesc(Arg<T, Tag> const &from)
+    : kind(from.kind),
+      name(from.name),
+      is_required(from.is_required),
+      has_default(from.has_default()),
+      grp_kind(from.grp_kind),
+      grp_id(from.grp_id),
+      env(from.env) {}
+
+  [[nodiscard]] constexpr bool has_group() const noexcept { return grp_kind != GroupKind::NONE; }
+};
+
+// The descriptions of `descs` followed by those of `more`
+template <std::size_t N, std::size_t M>
+constexpr std::array<ArgDesc, N + M>
+concat_arg_descs(std::array<ArgDesc, N> const &descs, std::array<ArgDesc, M> const &more) {
+  std::array<ArgDesc, N + M> all;
+  for (std::size_t i = 0; i < N; ++i) {
+    all[i] = descs[i];
+  }
+  for (std::size_t i = 0; i < M; ++i) {
+    all[N + i] = more[i];
+  }
+  return all;
+}
+
+// Default value of options and flags, which is the value-initialized `T` if none was specified
+template <typename T, typename Tag>
+constexpr std::optional<T> default_value_of(ArgMeta<T, Tag> const &meta) {
+  if constexpr (is_allocator_aware<T>) return meta.default_value; // see `is_allocator_aware`
+  else return meta.default_value.value_or(T{});
+}
+
 // +---------------------------------+
 // |       ArgMeta validations       |
 // +---------------------------------+
@@ -110,19 +198,26 @@ consteval void validate_common(ArgMeta<T, Tag> const &meta) {
     throw "Argument names must be longer than 1 character and not contain any whitespace";
   if constexpr (Abbrev.size != 0 && (Abbrev.size > 1 || !is_valid_name(Abbrev)))
     throw "Argument abbreviations, if specified, must be a single non-whitespace character";
+  if (!meta.env.empty() && (!is_valid_name(meta.env) || meta.env.find('=') != std::string_view::npos))
+    throw "Environment variable names, if specified, must contain neither whitespace nor `=`";
 
   if (meta.is_required.has_value()) {
     if (*meta.is_required && meta.default_value.has_value()) throw "Required arguments cannot have default values";
     if (!*meta.is_required && !meta.default_value.has_value()) throw "Optional arguments must have default values";
   }
   if constexpr (concepts::Container<T>) {
-    if constexpr ((std::is_same_v<Tag, act::append> || std::is_same_v<Tag, act::csv>))
+    if constexpr ((std::is_same_v<Tag, act::append> || act::is_csv<Tag>))
       if (meta.implicit_value.has_value())
         // CSV would be allowed if the next if wasn't needed
         throw "Implicit value cannot be used with the APPEND or CSV actions since they require a value from the command-line";
     if ((meta.default_value.has_value() && meta.default_value.value().size() > 0) ||
         (meta.implicit_value.has_value() && meta.implicit_value.value().size() > 0))
       throw "Arguments of container types (e.g. std::vector) do not support non-empty default or implicit values";
+    if constexpr (act::is_csv<Tag>) {
+      if constexpr (Tag::escape != '\0' && std::is_same_v<typename T::value_type, std::string_view>)
+        throw "CSV escapes cannot be used with containers of std::string_view, since unescaped values are copies";
+      if constexpr (Tag::delimiter == Tag::escape) throw "The CSV delimiter and escape must be different characters";
+    }
   }
 }
 
@@ -162,7 +257,7 @@ consteval void validate_flg(ArgMeta<T, Tag> const &meta) {
       throw "Flags that are neither boolean nor integer types require that the implicit value is specified";
   if constexpr (std::is_same_v<Tag, act::count> && !concepts::Integer<T>)
     throw "The COUNT action cannot be used with non-integer types";
-  if constexpr (std::is_same_v<Tag, act::csv>)
+  if constexpr (act::is_csv<Tag>)
     throw "The CSV action cannot be used with flags; use regular ASSIGN instead";
   if constexpr (concepts::Container<T>) throw "Flags do not support container types (e.g. std::vector)";
 }
@@ -0,0 +1,61 @@
+#ifndef OPZIONI_ARG_STREAM_HPP
+#define OPZIONI_ARG_STREAM_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace opz {
+
+// Arguments read incrementally from a file descriptor (e.g. stdin), each one terminated by `delimiter` (like the output
+// of `find -print0` or `xargs -0` input). Data is read in big chunks that are never moved or freed while the stream is
+// alive, so the returned arguments are views into them. An argument that doesn't fit in what is left of a chunk is
+// the only thing that gets copied, to the beginning of the next one.
+class ArgStream {
+public:
+
+  static constexpr std::size_t default_chunk_size = std::size_t{1} << 20;
+
+  explicit ArgStream(
+    int fd,
+    char delimiter = '\0',
+    std::size_t chunk_size = default_chunk_size,
+    std::pmr::memory_resource *mem_resource = std::pmr::get_default_resource()
+  );
+
+  ArgStream(ArgStream &&other) noexcept;
+  ArgStream &operator=(ArgStream &&other) noexcept;
+  ArgStream(ArgStream const &) = delete;
+  ArgStream &operator=(ArgStream const &) = delete;
+  ~ArgStream();
+
+  // The next argument, or nullopt once the end of the file has been reached. The last argument may lack a delimiter.
+  [[nodiscard]] std::optional<std::string_view> next();
+
+private:
+
+  struct Chunk {
+    char *data;
+    std::size_t size;
+  };
+
+  int fd;
+  char delimiter;
+  std::size_t chunk_size;
+  std::pmr::memory_resource *mem_resource; // where chunks come from
+  std::pmr::vector<Chunk> chunks;
+  // all in the last chunk: [begin, end) is data not yet returned, of which [begin, searched) has no delimiter
+  std::size_t begin{0};
+  std::size_t searched{0};
+  std::size_t end{0};
+  bool eof{false};
+
+  void read_more();
+  void release() noexcept;
+};
+
+} // namespace opz
+
+#endif // OPZIONI_ARG_STREAM_HPP
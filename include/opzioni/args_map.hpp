@@ -1,13 +1,28 @@
 #ifndef OPZIONI_ARGS_MAP_HPP
 #define OPZIONI_ARGS_MAP_HPP
 
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
+#include "opzioni/arg.hpp"
+#include "opzioni/arg_stream.hpp"
+#include "opzioni/command_line.hpp"
 #include "opzioni/concepts.hpp"
 #include "opzioni/exceptions.hpp"
 #include "opzioni/fixed_string.hpp"
 #include "opzioni/get_type.hpp"
+#include "opzioni/response_file.hpp"
 #include "opzioni/string_list.hpp"
 #include "opzioni/type_list.hpp"
 #include "opzioni/variant.hpp"
@@ -28,22 +43,104 @@ struct TupleOf<TypeList<Ts...>> {
   using type = std::tuple<std::optional<Ts>...>;
 };
 
+// Binds the argument named `Name` to the data member `Member` of a struct (see `ArgsMap::into`)
+template <FixedString Name, auto Member>
+struct Field {
+  static constexpr auto name = Name;
+  static constexpr auto member = Member;
+};
+
 template <concepts::Cmd Cmd>
 struct ArgsMap {
   using cmd_type = Cmd;
 
+  static constexpr std::size_t origin_bits = 2; // enough for all of ArgOrigin
+  static constexpr std::size_t args_count = std::tuple_size_v<typename TupleOf<typename Cmd::arg_types>::type>;
+
+  // Converts the raw values of the argument at the given index into its value (see `defer_conversion`)
+  using Converter = void (*)(ArgsMap const &, std::size_t);
+
   std::string_view exec_path{};
-  TupleOf<typename Cmd::arg_types>::type args;
+  // values of the arguments, which are written by `get` (and others) too when their conversion was deferred
+  mutable TupleOf<typename Cmd::arg_types>::type args;
+  // origin of the value of each argument, as `origin_bits` bits per argument (only meaningful if it has a value)
+  std::bitset<origin_bits * args_count> origins{};
   ArgsMapOf<typename Cmd::subcmd_types>::type submap{};
+  // where allocator-aware values (e.g. `std::pmr::vector`) get their memory from; must outlive the map
+  std::pmr::memory_resource *mem_resource{std::pmr::get_default_resource()};
+  // mappings of the response and config files that were read, which values may point into (only set in the root map)
+  std::pmr::vector<MappedFile> mapped_files{mem_resource};
+  // arguments that were read from a stream, which values may point into (only set in the root map)
+  std::optional<ArgStream> arg_stream{};
+  // arguments split from a command string, which values may point into (only set in the root map)
+  std::optional<CommandLine> command_line{};
+
+  // With lazy conversion, the raw values of each argument (a range of `raw_values`) that are still to be converted, by
+  // the converter of the command, which has access to it
+  std::pmr::vector<std::string_view> raw_values{mem_resource};
+  std::array<std::pair<std::uint32_t, std::uint32_t>, args_count> raw_ranges{};
+  mutable std::bitset<args_count> unconverted{};
+  Converter converter{nullptr};
+  Cmd const *cmd{nullptr};
+
+  template <FixedString Name>
+  using value_type_of = GetType<Name, typename cmd_type::arg_names, typename cmd_type::arg_types>::type;
+
+  // Copy of the value of an argument, converting it first if its conversion was deferred (see `at`)
+  template <FixedString Name>
+  [[nodiscard]] value_type_of<Name> get() const {
+    return this->at<Name>();
+  }
+
+  // Values of several arguments at once, as references (e.g. `auto const &[a, b] = map.get<"a", "b">();`)
+  template <FixedString... Names>
+    requires(sizeof...(Names) > 1)
+  [[nodiscard]] std::tuple<value_type_of<Names> const &...> get() const {
+    return {this->at<Names>()...};
+  }
 
+  // Value of an argument without copying it; the reference is valid as long as the map is and isn't reset. If its
+  // conversion was deferred, this converts and stores it, so it is not safe to call concurrently with any other access
+  // to the same map until `validate_all` was called (see `ExtraConfig::lazy_conversion`).
   template <FixedString Name>
-  [[nodiscard]] GetType<Name, typename cmd_type::arg_names, typename cmd_type::arg_types>::type get() const {
+  [[nodiscard]] value_type_of<Name> const &at() const {
     constexpr auto idx = this->idx_of<Name>();
-    auto const arg = std::get<idx>(args);
+    this->convert_deferred<idx>();
+    auto const &arg = std::get<idx>(this->args);
     if (!arg) throw ArgumentNotFound(Name.data);
     return *arg;
   }
 
+  // Moves the value of an argument out of the map, which then doesn't have a value for it anymore
+  template <FixedString Name>
+  [[nodiscard]] value_type_of<Name> take() {
+    constexpr auto idx = this->idx_of<Name>();
+    this->convert_deferred<idx>();
+    auto &arg = std::get<idx>(this->args);
+    if (!arg) throw ArgumentNotFound(Name.data);
+    auto value = std::move(*arg);
+    arg.reset();
+    return value;
+  }
+
+  // Moves the values of the arguments into a struct, without looking up each of them by name. By default, the fields of
+  // `Struct` are initialized in declaration order from the arguments in the order they were added (skipping help and
+  // version, which have no value to keep), so each of those arguments must have a value. Otherwise, each `Field` binds
+  // one argument to a data member of a default-constructed `Struct`, where a `std::optional` member may be left empty.
+  // Views in the values may point into files that the map keeps, so the map has to outlive the struct in that case.
+  template <typename Struct, typename... Fields>
+  [[nodiscard]] Struct into() {
+    if constexpr (sizeof...(Fields) == 0) {
+      return [this]<std::size_t... Is>(std::index_sequence<Is...>) {
+        return Struct{this->take_value<value_idxs[Is]>()...};
+      }(std::make_index_sequence<value_idxs.size()>());
+    } else {
+      Struct into{};
+      (this->move_into<Fields::name>(into.*Fields::member), ...);
+      return into;
+    }
+  }
+
   template <concepts::Cmd SubCmd>
   [[nodiscard]] ArgsMap<SubCmd const> const *get(SubCmd const &) const noexcept {
     return std::get_if<ArgsMap<SubCmd const>>(&submap);
@@ -56,7 +153,7 @@ struct ArgsMap {
 
   template <int Idx>
   [[nodiscard]] bool has_value() const noexcept {
-    return std::get<Idx>(this->args).has_value();
+    return std::get<Idx>(this->args).has_value() || this->unconverted[Idx];
   }
 
   template <FixedString Name>
@@ -65,7 +162,125 @@ struct ArgsMap {
     return this->has_value<idx>();
   }
 
+  template <int Idx>
+  [[nodiscard]] ArgOrigin origin_of() const noexcept {
+    unsigned origin = 0;
+    for (std::size_t bit = 0; bit < origin_bits; ++bit) {
+      origin |= static_cast<unsigned>(this->origins[Idx * origin_bits + bit]) << bit;
+    }
+    return static_cast<ArgOrigin>(origin);
+  }
+
+  template <FixedString Name>
+  [[nodiscard]] ArgOrigin origin_of() const noexcept {
+    constexpr auto idx = this->idx_of<Name>();
+    return this->origin_of<idx>();
+  }
+
+  void set_origin(std::size_t const idx, ArgOrigin const origin) noexcept {
+    for (std::size_t bit = 0; bit < origin_bits; ++bit) {
+      this->origins[idx * origin_bits + bit] = (static_cast<unsigned>(origin) >> bit) & 1u;
+    }
+  }
+
   [[nodiscard]] bool has_submap() const noexcept { return !std::holds_alternative<empty>(submap); }
+
+  // Keeps `values` to be converted into the value of an argument when it is first accessed
+  void defer_conversion(std::size_t const idx, std::span<std::string_view const> const values) {
+    this->raw_ranges[idx] = {
+      static_cast<std::uint32_t>(this->raw_values.size()), static_cast<std::uint32_t>(values.size())
+    };
+    this->raw_values.insert(this->raw_values.end(), values.begin(), values.end());
+    this->unconverted[idx] = true;
+  }
+
+  [[nodiscard]] std::span<std::string_view const> raw_values_of(std::size_t const idx) const noexcept {
+    auto const [offset, amount] = this->raw_ranges[idx];
+    return std::span(this->raw_values).subspan(offset, amount);
+  }
+
+  // Converts the value of an argument if its conversion was deferred, which is then cached
+  template <int Idx>
+  void convert_deferred() const {
+    if (!this->unconverted[Idx]) return;
+    this->converter(*this, Idx);
+    this->unconverted[Idx] = false;
+  }
+
+  // Converts all values whose conversion was deferred, in this map and in the one of the subcommand, so that any
+  // conversion errors are thrown right away. Afterwards, the const member functions of the map only read from it, so it
+  // may be shared between threads.
+  void validate_all() const {
+    [this]<std::size_t... Is>(std::index_sequence<Is...>) {
+      (this->convert_deferred<Is>(), ...);
+    }(std::make_index_sequence<args_count>());
+    std::visit(
+      [](auto const &submap) {
+        if constexpr (!std::is_same_v<std::remove_cvref_t<decltype(submap)>, empty>) submap.validate_all();
+      },
+      this->submap
+    );
+  }
+
+  // Forgets all values, as if nothing had been parsed, so that the map can be parsed into again. Their memory goes back
+  // to `mem_resource`, which is where it is taken from the next time (see `ReusableParser`).
+  void reset() noexcept {
+    this->exec_path = {};
+    std::apply([](auto &...arg) { (arg.reset(), ...); }, this->args);
+    this->origins.reset();
+    this->submap.template emplace<empty>();
+    this->mapped_files.clear();
+    this->arg_stream.reset();
+    this->command_line.reset();
+    this->raw_values.clear();
+    this->unconverted.reset();
+  }
+
+private:
+  // indices of the arguments that may have a value (i.e. all but help and version)
+  static constexpr auto value_idxs = [] {
+    constexpr auto is_value = []<std::size_t I>(std::integral_constant<std::size_t, I>) {
+      using tag_type = typename std::remove_cvref_t<std::tuple_element_t<I, decltype(Cmd::args)>>::tag_type;
+      return !std::is_same_v<tag_type, act::print_help> && !std::is_same_v<tag_type, act::print_version>;
+    };
+    return [is_value]<std::size_t... Is>(std::index_sequence<Is...>) {
+      std::array<std::size_t, (0 + ... + std::size_t{is_value(std::integral_constant<std::size_t, Is>{})})> idxs{};
+      std::size_t amount = 0;
+      ((is_value(std::integral_constant<std::size_t, Is>{}) ? void(idxs[amount++] = Is) : void()), ...);
+      return idxs;
+    }(std::make_index_sequence<args_count>());
+  }();
+
+  template <std::size_t Idx>
+  [[nodiscard]] auto take_value() {
+    this->convert_deferred<Idx>();
+    auto &arg = std::get<Idx>(this->args);
+    if (!arg) throw ArgumentNotFound(StringArrayOf<typename Cmd::arg_names>::value[Idx]);
+    return std::move(*arg);
+  }
+
+  template <FixedString Name, typename Member>
+  void move_into(Member &member) {
+    constexpr auto idx = this->idx_of<Name>();
+    static_assert(idx != -1, "Field is bound to an argument that doesn't exist");
+    this->convert_deferred<idx>();
+    auto &arg = std::get<idx>(this->args);
+    if constexpr (std::is_same_v<Member, std::remove_cvref_t<decltype(arg)>>) {
+      member = std::move(arg);
+    } else {
+      if (!arg) throw ArgumentNotFound(Name.data);
+      member = std::move(*arg);
+    }
+  }
+
+public:
+  // Constructs a value for one of the arguments, passing it `mem_resource` if it is allocator-aware
+  template <typename T, typename... Args>
+  [[nodiscard]] T make_value(Args &&...args) const {
+    return std::make_obj_using_allocator<T>(
+      std::pmr::polymorphic_allocator<>(this->mem_resource), std::forward<Args>(args)...
+    );
+  }
 };
 
 } // namespace opz
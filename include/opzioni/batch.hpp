@@ -0,0 +1,125 @@
+#ifndef OPZIONI_BATCH_HPP
+#define OPZIONI_BATCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "opzioni/concepts.hpp"
+#include "opzioni/exceptions.hpp"
+#include "opzioni/parsing.hpp"
+
+namespace opz {
+
+// Outcome of validating one command line of a batch: the message of its error, or nothing if it is valid
+using BatchResult = std::optional<std::string>;
+
+struct BatchOptions {
+  // threads to parse with, or as many as the hardware supports if 0
+  unsigned threads{0};
+  // how many command lines a thread takes at once from the ones left
+  std::size_t chunk_size{64};
+};
+
+// Parses `amount` command lines with `parse_ith(parser, map, i)`, split in chunks among threads that each have a
+// ReusableParser (so their memory is their own and reused across parses) while sharing the command itself, which is
+// never written to. Asking for help or the version is valid, and values whose conversion was deferred are converted.
+// Chunks are handed out from a single shared counter rather than stolen from per-thread queues: all the work is known
+// up front and every chunk costs about the same, so a thread that runs out just takes the next one, which costs one
+// atomic increment per chunk.
+// Anything else that is thrown (e.g. by `parse_ith` or by running out of memory) stops all threads from taking more
+// chunks and is rethrown here, on the calling thread, once they are done.
+template <concepts::Cmd Cmd, typename ParseIth>
+[[nodiscard]] std::vector<BatchResult>
+validate_batch(Cmd const &cmd, std::size_t const amount, BatchOptions const options, ParseIth const &parse_ith) {
+  std::vector<BatchResult> results(amount);
+  std::atomic<std::size_t> next_chunk{0};
+  std::atomic<bool> failed{false};
+  auto const chunk_size = std::max(options.chunk_size, std::size_t{1});
+
+  auto const worker = [&cmd, &results, &next_chunk, &failed, &parse_ith, amount, chunk_size](
+                        std::exception_ptr &failure
+                      ) {
+    try {
+      ReusableParser<Cmd> parser(cmd);
+      auto map = parser.new_map();
+      // threads that finish their chunks sooner take more of them, so uneven command lines balance out
+      for (auto begin = next_chunk.fetch_add(chunk_size); begin < amount && !failed.load(std::memory_order_relaxed);
+           begin = next_chunk.fetch_add(chunk_size)) {
+        for (auto i = begin; i < std::min(begin + chunk_size, amount); ++i) {
+          if (auto const outcome = parse_ith(parser, map, i); !outcome) {
+            if (outcome.error().is_error()) results[i] = outcome.error().message();
+            continue;
+          }
+          try {
+            map.validate_all();
+          } catch (std::runtime_error const &e) { // conversion errors
+            results[i] = e.what();
+          }
+        }
+      }
+    } catch (...) {
+      failure = std::current_exception();
+      failed.store(true, std::memory_order_relaxed);
+    }
+  };
+
+  auto const hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  auto const threads = std::min<std::size_t>(
+    options.threads == 0 ? hardware_threads : options.threads, (amount + chunk_size - 1) / chunk_size
+  );
+  // one for each thread, which only it writes to
+  std::vector<std::exception_ptr> failures(std::max(threads, std::size_t{1}));
+  if (threads <= 1) {
+    worker(failures.front());
+  } else {
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+      pool.emplace_back(worker, std::ref(failures[i]));
+    }
+    worker(failures.front()); // the calling thread works too instead of only waiting
+  } // destroying `pool` joins its threads
+  for (auto const &failure : failures) {
+    if (failure) std::rethrow_exception(failure);
+  }
+  return results;
+}
+
+// Validates each of `argvs` (with the command name first, as in `main`) against `cmd`
+template <concepts::Cmd Cmd>
+[[nodiscard]] std::vector<BatchResult>
+validate_batch(Cmd const &cmd, std::span<std::span<char const *> const> const argvs, BatchOptions const options = {}) {
+  return validate_batch(cmd, argvs.size(), options, [argvs](auto &parser, auto &map, std::size_t const i) {
+    return parser.try_parse_into(map, argvs[i]);
+  });
+}
+
+// Validates each line of `lines` against `cmd`, with the arguments after the command name split as a shell would (see
+// `CommandLine`). A newline at the very end doesn't start another (empty) command line.
+template <concepts::Cmd Cmd>
+[[nodiscard]] std::vector<BatchResult>
+validate_batch(Cmd const &cmd, std::string_view const lines, BatchOptions const options = {}) {
+  std::vector<std::string_view> split_lines;
+  for (std::size_t begin = 0; begin < lines.size();) {
+    auto const end = std::min(lines.find(nl, begin), lines.size());
+    split_lines.push_back(lines.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return validate_batch(cmd, split_lines.size(), options, [&split_lines](auto &parser, auto &map, std::size_t const i) {
+    return parser.try_parse_into(map, split_lines[i]);
+  });
+}
+
+} // namespace opz
+
+#endif // OPZIONI_BATCH_HPP
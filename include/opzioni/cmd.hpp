@@ -1,16 +1,27 @@
 #ifndef OPZIONI_CMD_HPP
 #define OPZIONI_CMD_HPP
 
+#include <algorithm>
+#include <array>
+#include <expected>
 #include <functional>
+#include <memory_resource>
 #include <optional>
 #include <source_location>
 #include <tuple>
 
 #include "opzioni/arg.hpp"
+#include "opzioni/arg_stream.hpp"
+#include "opzioni/command_line.hpp"
+#include "opzioni/config_file.hpp"
 #include "opzioni/concepts.hpp"
 #include "opzioni/exceptions.hpp"
+#include "opzioni/extra.hpp"
 #include "opzioni/fixed_string.hpp"
+#include "opzioni/lookup.hpp"
+#include "opzioni/outcome.hpp"
 #include "opzioni/parsing.hpp"
+#include "opzioni/response_file.hpp"
 #include "opzioni/strings.hpp"
 
 namespace opz {
@@ -24,6 +35,20 @@ using ErrorHandler = int (*)(UserError &);
 struct ExtraConfig {
   std::optional<std::size_t> msg_width{};
   std::optional<ErrorHandler> error_handler{};
+  // expand `@path` arguments into the arguments in the file at `path` (only taken into account for the root command)
+  std::optional<ResponseFileConfig> response_files{};
+  // prefix of the environment variables that supply values for arguments that are not in the command line, which is
+  // followed by the argument name in uppercase and with dashes replaced by underscores (e.g. `APP_` -> `APP_DRY_RUN`)
+  std::optional<std::string_view> env_prefix{};
+  // keep the values of arguments as they are in the command line and convert them when they are first accessed, so
+  // that arguments that are never looked at cost nothing to convert. Conversion errors are then thrown by
+  // `ArgsMap::get`, or all at once by `ArgsMap::validate_all`, rather than reported when parsing. Since the first access
+  // writes the converted value into the map, even through a const reference, a map with unconverted values must not be
+  // read from several threads at once; call `validate_all` before sharing it, after which reads don't write anymore.
+  std::optional<bool> lazy_conversion{};
+  // also accept any unambiguous prefix of the name or of an alias of a subcommand (e.g. `ch` for `checkout`, if no other
+  // subcommand starts with `ch`). The exact name always wins, even if it is the prefix of another.
+  std::optional<bool> subcmd_prefixes{};
 };
 
 template <typename...> struct Cmd;
@@ -48,6 +73,8 @@ struct Cmd<
   using arg_types = TypeList<Types...>;
   using arg_tags = TypeList<Tags...>;
   using subcmd_types = TypeList<SubCmds...>;
+  // levels of commands from this one down, counting it (see `max_cmd_depth`)
+  static constexpr std::size_t depth = 1 + std::max({std::size_t{0}, SubCmds::depth...});
   // clang-format off
   // using amount_pos = std::integral_constant<std::size_t, (0 + ... + static_cast<std::size_t>(Kinds == ArgKind::POS))>;
   // clang-format on
@@ -59,9 +86,17 @@ struct Cmd<
   ErrorHandler error_handler{print_error_and_usage};
   GroupKind grp_kind{GroupKind::NONE};
   std::uint_least32_t grp_id{0};
+  std::optional<ResponseFileConfig> response_files{};
+  std::string_view env_prefix{};
+  bool lazy_conversion{false};
+  bool subcmd_prefixes{false};
+  std::array<std::string_view, max_cmd_aliases> aliases{}; // the empty ones are unused
 
   std::tuple<Arg<Types, Tags> const...> args;
+  // what parsing needs of each of `args`, as an array that the parser core can index at run time
+  std::array<ArgDesc, sizeof...(Types)> arg_descs{};
   std::tuple<std::reference_wrapper<SubCmds const> const...> subcmds;
+  SubcmdLookup<sizeof...(SubCmds)> subcmd_lookup{};
 
   consteval Cmd() = default;
   explicit consteval Cmd(std::string_view const name, std::string_view const version = "")
@@ -78,8 +113,15 @@ struct Cmd<
       error_handler(other.error_handler),
       grp_kind(other.grp_kind),
       grp_id(other.grp_id),
+      response_files(other.response_files),
+      env_prefix(other.env_prefix),
+      lazy_conversion(other.lazy_conversion),
+      subcmd_prefixes(other.subcmd_prefixes),
+      aliases(other.aliases),
       args(other.args),
-      subcmds(other.subcmds) {}
+      arg_descs(other.arg_descs),
+      subcmds(other.subcmds),
+      subcmd_lookup(other.subcmd_lookup) {}
 
   template <concepts::Cmd OtherCmd, typename T, typename Tag>
   consteval Cmd(OtherCmd const &other, Arg<T, Tag> const new_arg)
@@ -90,8 +132,15 @@ struct Cmd<
       error_handler(other.error_handler),
       grp_kind(other.grp_kind),
       grp_id(other.grp_id),
+      response_files(other.response_files),
+      env_prefix(other.env_prefix),
+      lazy_conversion(other.lazy_conversion),
+      subcmd_prefixes(other.subcmd_prefixes),
+      aliases(other.aliases),
       args(std::tuple_cat(other.args, std::make_tuple(new_arg))),
-      subcmds(other.subcmds) {}
+      arg_descs(concat_arg_descs(other.arg_descs, std::array{ArgDesc(new_arg)})),
+      subcmds(other.subcmds),
+      subcmd_lookup(other.subcmd_lookup) {}
 
   template <concepts::Cmd OtherCmd, concepts::Cmd NewSubCmd>
   consteval Cmd(OtherCmd const &other, NewSubCmd const &new_subcmd)
@@ -102,8 +151,17 @@ struct Cmd<
       error_handler(other.error_handler),
       grp_kind(other.grp_kind),
       grp_id(other.grp_id),
+      response_files(other.response_files),
+      env_prefix(other.env_prefix),
+      lazy_conversion(other.lazy_conversion),
+      subcmd_prefixes(other.subcmd_prefixes),
+      aliases(other.aliases),
       args(other.args),
-      subcmds(std::tuple_cat(other.subcmds, std::make_tuple(std::cref(new_subcmd)))) {}
+      arg_descs(other.arg_descs),
+      subcmds(std::tuple_cat(other.subcmds, std::make_tuple(std::cref(new_subcmd)))),
+      subcmd_lookup(
+        make_subcmd_lookup<sizeof...(SubCmds)>(other.subcmd_lookup, new_subcmd.name, new_subcmd.aliases)
+      ) {}
 
   template <concepts::Cmd OtherCmd, typename... OtherTypes, typename... OtherTags>
   consteval Cmd(OtherCmd const &other, std::tuple<Arg<OtherTypes, OtherTags> const...> new_args)
@@ -114,8 +172,18 @@ struct Cmd<
       error_handler(other.error_handler),
       grp_kind(other.grp_kind),
       grp_id(other.grp_id),
+      response_files(other.response_files),
+      env_prefix(other.env_prefix),
+      lazy_conversion(other.lazy_conversion),
+      subcmd_prefixes(other.subcmd_prefixes),
+      aliases(other.aliases),
       args(std::tuple_cat(other.args, new_args)),
-      subcmds(other.subcmds) {}
+      arg_descs(concat_arg_descs(
+        other.arg_descs,
+        std::apply([](auto const &...arg) { return std::array<ArgDesc, sizeof...(arg)>{ArgDesc(arg)...}; }, new_args)
+      )),
+      subcmds(other.subcmds),
+      subcmd_lookup(other.subcmd_lookup) {}
 
   template <
     FixedString... OtherNames,
@@ -176,6 +244,17 @@ struct Cmd<
     return *this;
   }
 
+  // Another name that the command may be called by as a subcommand (e.g. `co` for `checkout`)
+  [[nodiscard]] consteval auto alias(std::string_view const alias) {
+    if (!is_valid_name(alias)) throw "Command aliases must neither be empty nor contain any whitespace";
+    if (alias == this->name || std::ranges::find(this->aliases, alias) != this->aliases.end())
+      throw "The command already has this name or alias";
+    auto const unused = std::ranges::find(this->aliases, std::string_view{});
+    if (unused == this->aliases.end()) throw "Commands cannot have more than `max_cmd_aliases` aliases";
+    *unused = alias;
+    return *this;
+  }
+
   [[nodiscard]] consteval auto with(ExtraConfig const cfg) {
     if (cfg.msg_width.has_value()) {
       if (*cfg.msg_width == 0) throw "The message width must be greater than zero";
@@ -185,6 +264,17 @@ struct Cmd<
       if (*cfg.error_handler == nullptr) throw "The error handler cannot be null";
       this->error_handler = *cfg.error_handler;
     }
+    if (cfg.response_files.has_value()) {
+      if (cfg.response_files->max_depth == 0) throw "The maximum depth of response files must be greater than zero";
+      this->response_files = cfg.response_files;
+    }
+    if (cfg.env_prefix.has_value()) {
+      if (!is_valid_name(*cfg.env_prefix) || cfg.env_prefix->find('=') != std::string_view::npos)
+        throw "The environment variable prefix must neither be empty nor contain whitespace or `=`";
+      this->env_prefix = *cfg.env_prefix;
+    }
+    if (cfg.lazy_conversion.has_value()) this->lazy_conversion = *cfg.lazy_conversion;
+    if (cfg.subcmd_prefixes.has_value()) this->subcmd_prefixes = *cfg.subcmd_prefixes;
     return *this;
   }
 
@@ -193,8 +283,7 @@ struct Cmd<
     static_assert(
       !InArgKindList<ArgKind::POS, arg_kinds>::value, "Commands that have positional arguments cannot have subcommands"
     );
-    if (auto const existing_cmd_idx = find_cmd(subcmds, subcmd.name); existing_cmd_idx != -1)
-      throw "Subcommand with this name already exists";
+    static_assert(NewSubCmd::depth < max_cmd_depth, "Commands cannot be nested deeper than `max_cmd_depth` levels");
     if (subcmd.grp_kind != GroupKind::NONE) throw "Subcommands cannot be in groups of any kind";
     Cmd<
       StringList<Names...>,
@@ -235,6 +324,7 @@ struct Cmd<
           .implicit_value = std::nullopt,
           .grp_kind = this->grp_kind,
           .grp_id = this->grp_id,
+          .env = meta.env,
         }
       );
     return new_cmd;
@@ -268,10 +358,11 @@ struct Cmd<
           .abbrev = Abbrev,
           .help = meta.help,
           .is_required = meta.is_required.value_or(false),
-          .default_value = meta.default_value.value_or(T{}),
+          .default_value = default_value_of(meta),
           .implicit_value = meta.implicit_value,
           .grp_kind = this->grp_kind,
           .grp_id = this->grp_id,
+          .env = meta.env,
         }
       );
     return new_cmd;
@@ -313,12 +404,13 @@ struct Cmd<
           .abbrev = Abbrev,
           .help = meta.help,
           .is_required = false,
-          .default_value = meta.default_value.value_or(T{}),
+          .default_value = default_value_of(meta),
           // the following dereference will not crash because we are validating non-bool non-int flags have
           // implicit_value
           .implicit_value = meta.implicit_value.value_or(*default_implicit_value),
           .grp_kind = this->grp_kind,
           .grp_id = this->grp_id,
+          .env = meta.env,
         }
       );
     return new_cmd;
@@ -330,16 +422,100 @@ struct Cmd<
   }
 
   [[nodiscard]] auto operator()(int const argc, char const *argv[]) const noexcept {
-    try {
-      auto parser = CmdParser(*this);
-      return parser(argc, argv);
-    } catch (UserError &ue) {
-      std::exit(this->error_handler(ue));
-    }
+    return (*this)(argc, argv, std::pmr::get_default_resource());
+  }
+
+  // Parses with all memory coming from `mem_resource`, which must outlive the returned map
+  [[nodiscard]] auto
+  operator()(int const argc, char const *argv[], std::pmr::memory_resource *const mem_resource) const noexcept {
+    auto result = CmdParser(*this, mem_resource).try_parse(std::span{argv, static_cast<std::size_t>(argc)});
+    if (!result) this->exit_with(result.error());
+    return std::move(*result);
+  }
+
+  // Parses a command string split like a shell would (see `CommandLine`), e.g. one read from a control socket. Values
+  // may point into `line`, which must outlive the returned map.
+  [[nodiscard]] auto operator()(
+    std::string_view const line, std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  ) const noexcept {
+    auto result = CmdParser(*this, mem_resource).try_parse(line);
+    if (!result) this->exit_with(result.error());
+    return std::move(*result);
+  }
+
+  // Parses `argv` falling back to the values in `config` (after the environment) for arguments that are not in it
+  [[nodiscard]] auto operator()(
+    int const argc,
+    char const *argv[],
+    ConfigFile const config,
+    std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  ) const noexcept {
+    auto result = CmdParser(*this, mem_resource).try_parse(std::span{argv, static_cast<std::size_t>(argc)}, config);
+    if (!result) this->exit_with(result.error());
+    return std::move(*result);
+  }
+
+  // Parses the arguments in `argv` followed by the ones read from `stream`, which the returned map takes ownership of
+  [[nodiscard]] auto operator()(
+    int const argc,
+    char const *argv[],
+    ArgStream stream,
+    std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  ) const noexcept {
+    auto result =
+      CmdParser(*this, mem_resource).try_parse(std::span{argv, static_cast<std::size_t>(argc)}, std::move(stream));
+    if (!result) this->exit_with(result.error());
+    return std::move(*result);
+  }
+
+  // Parses without exiting the program: errors, as well as asking for help or the version, are returned for the caller
+  // to handle (e.g. with `ParseOutcome::print`) instead of going to the error handler or being printed right away
+  [[nodiscard]] std::expected<ArgsMap<Cmd const>, ParseOutcome> try_parse(
+    std::span<char const *> const args, std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  ) const {
+    return CmdParser(*this, mem_resource).try_parse(args);
+  }
+
+  [[nodiscard]] std::expected<ArgsMap<Cmd const>, ParseOutcome> try_parse(
+    int const argc,
+    char const *argv[],
+    std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  ) const {
+    return this->try_parse(std::span{argv, static_cast<std::size_t>(argc)}, mem_resource);
+  }
+
+  // Parses a command string (see `CommandLine`) without exiting the program. Values may point into `line`, which must
+  // outlive the returned map.
+  [[nodiscard]] std::expected<ArgsMap<Cmd const>, ParseOutcome> try_parse(
+    std::string_view const line, std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  ) const {
+    return CmdParser(*this, mem_resource).try_parse(line);
+  }
+
+  // A parser for parsing many command lines in a row, which reuses its memory from one to the next
+  [[nodiscard]] auto
+  reusable_parser(std::pmr::memory_resource *const upstream = std::pmr::get_default_resource()) const {
+    return ReusableParser(*this, upstream);
+  }
+
+  // Index of the subcommand called `name` (or an alias of it) or, with `subcmd_prefixes`, of the only one that starts
+  // with `name`; -1 if there is none
+  [[nodiscard]] constexpr int find_subcmd(std::string_view const name) const noexcept {
+    if (auto const idx = this->subcmd_lookup.find(name); idx != -1 || !this->subcmd_prefixes) return idx;
+    return this->subcmd_lookup.find_prefix(name);
   }
 
   [[nodiscard]] constexpr bool has_subcmds() const noexcept { return std::tuple_size_v<decltype(this->subcmds)> > 0; }
   [[nodiscard]] constexpr bool has_group() const noexcept { return grp_kind != GroupKind::NONE; }
+
+private:
+
+  // Hands errors to the error handler, or prints the help page or the version, and exits with the code that it gives
+  [[noreturn]] void exit_with(ParseOutcome const &outcome) const noexcept {
+    if (!outcome.is_error()) std::exit(outcome.print());
+    UserError ue(outcome.error, outcome.formatter);
+    std::exit(this->error_handler(ue));
+  }
 };
 
 [[nodiscard]] consteval auto new_cmd(std::string_view const name, std::string_view const version = "") {
@@ -2,11 +2,13 @@
 #define OPZIONI_CMD_FMT_HPP
 
 #include <algorithm>
+#include <array>
 #include <cstdio>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include <fmt/format.h>
@@ -15,6 +17,7 @@
 #include "opzioni/arg.hpp"
 #include "opzioni/concepts.hpp"
 #include "opzioni/extra.hpp"
+#include "opzioni/lookup.hpp"
 #include "opzioni/strings.hpp"
 
 namespace opz {
@@ -22,8 +25,10 @@ namespace opz {
 struct CmdHelpEntry {
   std::string_view name{};
   std::string_view introduction{};
+  std::array<std::string_view, max_cmd_aliases> aliases{};
 
-  explicit CmdHelpEntry(concepts::Cmd auto const &from) : name(from.name), introduction(from.introduction) {}
+  explicit CmdHelpEntry(concepts::Cmd auto const &from)
+    : name(from.name), introduction(from.introduction), aliases(from.aliases) {}
 
   [[nodiscard]] std::string format_for_usage() const noexcept;
   [[nodiscard]] std::string format_for_index_entry() const noexcept;
@@ -72,6 +77,11 @@ struct ArgHelpEntry {
   bool operator<(ArgHelpEntry const &) const noexcept;
 };
 
+// Everything that the help page, usage and version of a command are made of. Pages are rendered when printed, rather
+// than at compile time (even though commands are constants, width included): default and implicit values are formatted
+// with `fmt::format`, which can't be evaluated at compile time (and neither can user formatters), and the usage of a
+// subcommand starts with the names of the commands it was reached through, which are only known while parsing, since
+// the same subcommand may be added to several commands.
 struct CmdFmt {
   std::string_view name;
   std::string_view version;
@@ -81,12 +91,14 @@ struct CmdFmt {
   std::vector<ArgHelpEntry> args;
   std::vector<CmdHelpEntry> subcmds;
 
-  CmdFmt(concepts::Cmd auto const &cmd, ExtraInfo const &extra_info)
+  CmdFmt(concepts::Cmd auto const &cmd, ExtraInfo const &extra_info) : CmdFmt(cmd, extra_info.parent_cmds_names) {}
+
+  CmdFmt(concepts::Cmd auto const &cmd, ParentCmdsNames const &parent_cmds_names)
     : name(cmd.name),
       version(cmd.version),
       introduction(cmd.introduction),
       msg_width(cmd.msg_width),
-      parent_cmds_names(extra_info.parent_cmds_names) {
+      parent_cmds_names(parent_cmds_names.begin(), parent_cmds_names.end()) {
     args.reserve(std::tuple_size_v<decltype(cmd.args)>);
     std::apply( // cast to void to suppress unused warning
       [this, &cmd](auto&&... arg) { (void) ((this->args.emplace_back(cmd.name, arg)), ...); },
@@ -99,14 +111,58 @@ struct CmdFmt {
     std::sort(subcmds.begin(), subcmds.end());
   }
 
+  // Each part is appended to `out`, so that a whole help page (or error) is written with a single call
+  void format_title(fmt::memory_buffer &out) const;
+  void format_intro(fmt::memory_buffer &out) const;
+  void format_usage(fmt::memory_buffer &out) const;
+  void format_help(fmt::memory_buffer &out) const;
+  void format_details(fmt::memory_buffer &out) const;
+  void format_arg_help(fmt::memory_buffer &, std::string_view, std::string_view, std::size_t) const;
+  // title, introduction, usage, help and details, as printed by `--help`
+  void format_help_page(fmt::memory_buffer &out) const;
+
   void print_title(std::FILE *f = stdout) const noexcept;
   void print_intro(std::FILE *f = stdout) const noexcept;
   void print_usage(std::FILE *f = stdout) const noexcept;
   void print_help(std::FILE *f = stdout) const noexcept;
   void print_details(std::FILE *f = stdout) const noexcept;
-  void print_arg_help(std::FILE *, std::string const &, std::string const &, std::size_t) const noexcept;
+  void print_help_page(std::FILE *f = stdout) const noexcept;
+};
+
+// The CmdFmt of a command, which is only built when needed (e.g. to print usage) because that formats all of its
+// arguments. Errors carry this instead, so that handling one that is never printed is cheap. It is a pointer to the
+// command, which must outlive it, and the names of the commands above it, so copying it doesn't allocate.
+class LazyCmdFmt {
+public:
+
+  std::size_t msg_width;
+
+  LazyCmdFmt(concepts::Cmd auto const &cmd, ExtraInfo const &extra_info)
+    : msg_width(cmd.msg_width),
+      cmd(&cmd),
+      make_fmt(&LazyCmdFmt::make<std::remove_cvref_t<decltype(cmd)>>),
+      parent_cmds_names(extra_info.parent_cmds_names) {}
+
+  [[nodiscard]] CmdFmt get() const { return this->make_fmt(this->cmd, this->parent_cmds_names); }
+
+  void format_usage(fmt::memory_buffer &out) const { this->get().format_usage(out); }
+  void print_usage(std::FILE *f = stdout) const noexcept { this->get().print_usage(f); }
+
+private:
+
+  void const *cmd;
+  CmdFmt (*make_fmt)(void const *, ParentCmdsNames const &);
+  ParentCmdsNames parent_cmds_names; // a copy, since the ExtraInfo of the parser doesn't outlive parsing
+
+  template <concepts::Cmd Cmd>
+  static CmdFmt make(void const *cmd, ParentCmdsNames const &parent_cmds_names) {
+    return CmdFmt(*static_cast<Cmd const *>(cmd), parent_cmds_names);
+  }
 };
 
+// Writes all of `buffer` to `f` with a single call
+void write_buffer(std::FILE *f, fmt::memory_buffer const &buffer) noexcept;
+
 } // namespace opz
 
 #endif // OPZIONI_CMD_FMT_HPP
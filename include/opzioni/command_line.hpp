@@ -0,0 +1,45 @@
+#ifndef OPZIONI_COMMAND_LINE_HPP
+#define OPZIONI_COMMAND_LINE_HPP
+
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace opz {
+
+// Arguments of a single command string (e.g. a line read from a control socket), split like a POSIX shell would:
+// on unquoted whitespace, with single quotes keeping everything literally, double quotes allowing `\"`, `\\`, `\$` and
+// `` \` ``, and a backslash outside quotes escaping the next character. There is no expansion of any kind.
+// Arguments without quotes or escapes are views into the line, which must outlive them, while the others are views
+// into a buffer of this object.
+class CommandLine {
+public:
+
+  explicit CommandLine(std::pmr::memory_resource *mem_resource = std::pmr::get_default_resource()) noexcept;
+
+  // views into `unescaped` have to keep pointing to it
+  CommandLine(CommandLine const &) = delete;
+  CommandLine &operator=(CommandLine const &) = delete;
+  CommandLine(CommandLine &&) noexcept = default;
+  CommandLine &operator=(CommandLine &&other);
+  ~CommandLine() = default;
+
+  // Splits `line`, replacing the previous arguments but keeping their memory
+  void reset(std::string_view line);
+
+  [[nodiscard]] std::span<std::string_view const> get_args() const noexcept { return this->args; }
+
+private:
+
+  std::pmr::vector<std::string_view> args;
+  // arguments that had quotes or escapes, without them; never reallocated while splitting, since it has room for the
+  // whole line and removing quotes and escapes only makes arguments shorter
+  std::pmr::vector<char> unescaped;
+
+  std::size_t unescaped_arg(std::string_view line, std::size_t idx);
+};
+
+} // namespace opz
+
+#endif // OPZIONI_COMMAND_LINE_HPP
@@ -0,0 +1,43 @@
+#ifndef OPZIONI_CONFIG_FILE_HPP
+#define OPZIONI_CONFIG_FILE_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace opz {
+
+// Config file with lines of `key = value`, where keys are argument names and values are as in the command line (but may
+// be quoted to keep surrounding whitespace). Lines after a `[sub]` or `[sub.subsub]` header are for that subcommand
+// instead of the root command. Lines starting with `#` or `;` are comments. Repeating a key appends to the argument.
+struct ConfigFile {
+  char const *path;
+  // a missing file is the same as an empty one, instead of an error
+  bool is_optional{false};
+};
+
+struct ConfigEntry {
+  std::string_view section; // e.g. `sub.subsub`, empty for the root command
+  std::string_view key;
+  std::string_view value;
+  std::size_t line;
+};
+
+// The entries of a config file that every command of a parse looks into for its own section
+struct ConfigLayer {
+  std::string_view path;
+  std::span<ConfigEntry const> entries;
+};
+
+// Entries of the config file in `contents`, which are views into it
+std::pmr::vector<ConfigEntry>
+parse_config(std::string_view path, std::string_view contents, std::pmr::memory_resource *mem_resource);
+
+// Whether `section` is the one for the subcommand at `cmd_path` (its names from the one below the root command)
+[[nodiscard]] bool is_section_of(std::string_view section, std::span<std::string_view const> cmd_path) noexcept;
+
+} // namespace opz
+
+#endif // OPZIONI_CONFIG_FILE_HPP
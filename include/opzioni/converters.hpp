@@ -1,59 +1,179 @@
 #ifndef OPZIONI_CONVERTERS_HPP
 #define OPZIONI_CONVERTERS_HPP
 
-#include <cerrno>
+#include <algorithm>
 #include <charconv>
-#include <cstdlib>
-#include <ranges>
+#include <concepts>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <type_traits>
 
 #include <fmt/format.h>
 
 #include "opzioni/concepts.hpp"
 #include "opzioni/exceptions.hpp"
+#include "opzioni/simd.hpp"
 
 namespace opz {
 
+// Why a value couldn't be converted (see `try_convert`)
+enum class ConversionErrc { empty, invalid, out_of_range };
+
+// Throws the ConversionError for `errc`, where `type` describes what `value` was being converted into
+[[noreturn]] void throw_conversion_error(std::string_view value, std::string_view type, ConversionErrc errc);
+
 template <typename TargetType>
 auto convert(std::string_view) -> TargetType;
 
+template <typename TargetType>
+auto try_convert(std::string_view) noexcept -> std::expected<TargetType, ConversionErrc>;
+
+// Strips a leading sign (which `std::from_chars` doesn't take for all types), returning whether it was a minus
+[[nodiscard]] constexpr bool strip_sign(std::string_view &str) noexcept {
+  if (str.empty() || (str.front() != '-' && str.front() != '+')) return false;
+  bool const is_negative = str.front() == '-';
+  str.remove_prefix(1);
+  return is_negative;
+}
+
+// Strips a `0x` or `0b` prefix (in any case), returning the base that the rest of `str` is in
+[[nodiscard]] constexpr int strip_base_prefix(std::string_view &str) noexcept {
+  if (str.size() <= 2 || str[0] != '0') return 10;
+  if (str[1] == 'x' || str[1] == 'X') {
+    str.remove_prefix(2);
+    return 16;
+  }
+  if (str[1] == 'b' || str[1] == 'B') {
+    str.remove_prefix(2);
+    return 2;
+  }
+  return 10;
+}
+
+// Sign and magnitude of an integer that has a plus or a `0x`/`0b` prefix (after the sign), which `std::from_chars`
+// doesn't take. It is compiled once in the library, so that the conversion of plain decimals is all that is left where
+// `try_convert` is used, and is small enough to be inlined there.
+struct SignedMagnitude {
+  std::uintmax_t magnitude;
+  bool is_negative;
+};
+[[nodiscard]] auto parse_prefixed_integer(std::string_view value) noexcept
+  -> std::expected<SignedMagnitude, ConversionErrc>;
+
+// Integers are parsed in full, in base 10 unless prefixed with `0x` or `0b`, optionally after a sign
 template <concepts::Integer Int>
-auto convert(std::string_view arg_val) -> Int {
-  if (arg_val.empty()) throw ConversionError("empty string", "an integer type");
+auto try_convert(std::string_view arg_val) noexcept -> std::expected<Int, ConversionErrc> {
+  if (arg_val.empty()) return std::unexpected(ConversionErrc::empty);
+  auto const *const end = arg_val.data() + arg_val.size();
+  // most values are plain decimal numbers, which `std::from_chars` takes as they are
   Int integer = 0;
-  auto const conv_result = std::from_chars(arg_val.data(), arg_val.data() + arg_val.size(), integer);
-  if (conv_result.ec == std::errc::invalid_argument) throw ConversionError(arg_val, "an integer type");
-  return integer;
+  if (auto const conv_result = std::from_chars(arg_val.data(), end, integer); conv_result.ptr == end) {
+    if (conv_result.ec == std::errc::result_out_of_range) return std::unexpected(ConversionErrc::out_of_range);
+    return integer;
+  }
+  auto const parsed = parse_prefixed_integer(arg_val);
+  if (!parsed) return std::unexpected(parsed.error());
+  auto const [magnitude, is_negative] = *parsed;
+  using Magnitude = std::make_unsigned_t<Int>;
+  if constexpr (std::is_signed_v<Int>) {
+    // the minimum has one more in magnitude than the maximum
+    if (magnitude > static_cast<std::uintmax_t>(std::numeric_limits<Int>::max()) + is_negative)
+      return std::unexpected(ConversionErrc::out_of_range);
+    auto const unsigned_magnitude = static_cast<Magnitude>(magnitude);
+    return static_cast<Int>(is_negative ? Magnitude{0} - unsigned_magnitude : unsigned_magnitude);
+  } else {
+    if ((is_negative && magnitude != 0) || magnitude > std::numeric_limits<Int>::max())
+      return std::unexpected(ConversionErrc::out_of_range);
+    return static_cast<Int>(magnitude);
+  }
+}
+
+// Floating point numbers are parsed in full regardless of the locale, in hexadecimal if prefixed with `0x`, optionally
+// after a sign. Infinity and NaN are accepted as `inf`, `infinity` and `nan`.
+template <std::floating_point Float>
+auto try_convert(std::string_view arg_val) noexcept -> std::expected<Float, ConversionErrc> {
+  if (arg_val.empty()) return std::unexpected(ConversionErrc::empty);
+  bool const is_negative = strip_sign(arg_val);
+  auto const format = strip_base_prefix(arg_val) == 16 ? std::chars_format::hex : std::chars_format::general;
+  // a second sign is left for `std::from_chars` to reject, except for a minus, which it takes
+  if (!arg_val.empty() && arg_val.front() == '-') return std::unexpected(ConversionErrc::invalid);
+  Float floatnum = 0;
+  auto const *const end = arg_val.data() + arg_val.size();
+  auto const conv_result = std::from_chars(arg_val.data(), end, floatnum, format);
+  if (conv_result.ec == std::errc::invalid_argument || conv_result.ptr != end)
+    return std::unexpected(ConversionErrc::invalid);
+  if (conv_result.ec == std::errc::result_out_of_range) return std::unexpected(ConversionErrc::out_of_range);
+  return is_negative ? -floatnum : floatnum;
+}
+
+template <concepts::Integer Int>
+auto convert(std::string_view arg_val) -> Int {
+  auto const integer = try_convert<Int>(arg_val);
+  if (!integer) throw_conversion_error(arg_val, "an integer type", integer.error());
+  return *integer;
 }
 
 template <std::floating_point Float>
 auto convert(std::string_view arg_val) -> Float {
-  if (arg_val.empty()) throw ConversionError("empty string", "a floating point type");
-  char *end = nullptr;
-  Float const floatnum = [&arg_val, &end]() -> Float {
-    if constexpr (std::is_same_v<Float, float>) {
-      return std::strtof(arg_val.data(), &end);
-    } else if constexpr (std::is_same_v<Float, long double>) {
-      return std::strtold(arg_val.data(), &end);
-    } else {
-      // should I explicitly test for double and do something
-      // different in the else branch?
-      return std::strtod(arg_val.data(), &end);
+  auto const floatnum = try_convert<Float>(arg_val);
+  if (!floatnum) throw_conversion_error(arg_val, "a floating point type", floatnum.error());
+  return *floatnum;
+}
+
+// Appends the values in `value` that are separated by `Delimiter` to `container`, so that callers may choose how it is
+// constructed. Unless `Escape` is `'\0'`, it makes the character after it part of a value (see `act::csv_with`). The
+// values are counted first, so that the container grows at most once.
+template <char Delimiter = ',', char Escape = '\0', concepts::Container Container>
+void convert_into(Container &container, std::string_view const value) {
+  using value_type = typename Container::value_type;
+  if (value.empty()) return;
+  // escaped delimiters are counted too, which only reserves a bit more than needed
+  if constexpr (requires { container.reserve(std::size_t{}); })
+    container.reserve(container.size() + count_of<Delimiter>(value) + 1);
+  if constexpr (Escape == '\0') {
+    for (std::size_t begin = 0;;) {
+      auto const end = std::min(value.find(Delimiter, begin), value.size());
+      container.emplace_back(convert<value_type>(value.substr(begin, end - begin)));
+      if (end == value.size()) return;
+      begin = end + 1;
+    }
+  } else {
+    std::string unescaped;
+    for (std::size_t begin = 0;;) {
+      auto end = find_any<Delimiter, Escape>(value, begin);
+      if (end < value.size() && value[end] == Escape) {
+        // only values with escapes are copied to be unescaped
+        unescaped.assign(value.substr(begin, end - begin));
+        while (end < value.size() && value[end] == Escape) {
+          // an escape at the very end has nothing to escape, so it is kept
+          if (end + 1 == value.size()) {
+            unescaped.push_back(Escape);
+            end = value.size();
+            break;
+          }
+          unescaped.push_back(value[end + 1]);
+          auto const next = find_any<Delimiter, Escape>(value, end + 2);
+          unescaped.append(value.substr(end + 2, next - (end + 2)));
+          end = next;
+        }
+        container.emplace_back(convert<value_type>(std::string_view(unescaped)));
+      } else {
+        container.emplace_back(convert<value_type>(value.substr(begin, end - begin)));
+      }
+      if (end == value.size()) return;
+      begin = end + 1;
     }
-  }();
-  if (errno == ERANGE || end == arg_val.data()) throw ConversionError(arg_val, "a floating point type");
-  return floatnum;
+  }
 }
 
 template <concepts::Container Container>
 auto convert(std::string_view value) -> Container {
   Container container;
-  if (!value.empty()) {
-    for (auto const val : value | std::views::split(',')) {
-      std::string_view const v{val.begin(), val.end()};
-      container.emplace_back(convert<typename Container::value_type>(v));
-    }
-  }
+  convert_into(container, value);
   return container;
 }
 
@@ -0,0 +1,52 @@
+#ifndef OPZIONI_ENV_HPP
+#define OPZIONI_ENV_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "opzioni/fixed_string.hpp"
+#include "opzioni/lookup.hpp"
+#include "opzioni/string_list.hpp"
+
+namespace opz {
+
+// Name of the environment variable derived from an argument name, to be looked up after the prefix of its command:
+// uppercase, with dashes replaced by underscores (e.g. `dry-run` -> `DRY_RUN`)
+template <FixedString Name>
+constexpr auto env_name_of = [] {
+  auto env_name = Name;
+  for (std::size_t i = 0; i < env_name.size; ++i) {
+    if (auto const ch = env_name.data[i]; ch >= 'a' && ch <= 'z') env_name.data[i] = static_cast<char>(ch - 'a' + 'A');
+    else if (ch == '-') env_name.data[i] = '_';
+  }
+  return env_name;
+}();
+
+template <typename...> struct EnvNamesOf;
+template <FixedString... Names>
+struct EnvNamesOf<StringList<Names...>> {
+  static constexpr auto value = make_perfect_hash<sizeof...(Names)>({std::string_view(env_name_of<Names>)...});
+};
+
+// What to look for in the environment on behalf of a single command
+struct EnvLookup {
+  // variables named `prefix` followed by one of the names in the perfect hash of `keys` (only if there is a prefix)
+  std::string_view prefix;
+  std::span<std::string_view const> keys;
+  std::span<std::uint32_t const> seeds;
+  std::span<int const> values;
+  // variable of each argument that was explicitly bound to one, or empty
+  std::span<std::string_view const> explicit_names;
+};
+
+// Fills `found` (one per argument) with the values of the variables in `lookup`, in a single pass over the environment.
+// Explicitly bound variables take precedence over the ones derived from the prefix.
+void read_env(EnvLookup const &lookup, std::span<std::optional<std::string_view>> found, std::pmr::memory_resource *);
+
+} // namespace opz
+
+#endif // OPZIONI_ENV_HPP
@@ -1,7 +1,12 @@
 #ifndef OPZIONI_EXCEPTIONS_HPP
 #define OPZIONI_EXCEPTIONS_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <utility>
 
@@ -34,101 +39,103 @@ public:
 // | user errors |
 // +-------------+
 
-// Base class for exceptions thrown because of errors from the users of the CLI program
+enum struct ErrorKind : std::uint8_t {
+  MISSING_REQUIRED_ARGUMENT,
+  UNEXPECTED_POSITIONAL,
+  UNKNOWN_ARGUMENTS,
+  UNKNOWN_SUBCOMMAND,
+  CONFLICTING_ARGUMENTS,
+  MISSING_ALL_REQUIRED_GROUPED_ARGUMENTS,
+  MISSING_MUTUALLY_EXCLUSIVE_GROUPED_ARGUMENTS,
+  INVALID_INPUT, // one of the runtime errors below (e.g. a value that can't be converted), which is the `cause`
+};
+
+inline constexpr std::size_t no_index = static_cast<std::size_t>(-1);
+
+// What went wrong, as data rather than as a message, which is only formatted if asked for (see `UserError::what`)
+struct ParseError {
+  ErrorKind kind;
+  std::string_view cmd_name;
+  // index of the argument that the error is about among those of the command, if any
+  std::size_t arg_idx{no_index};
+  // index of the token that the error is about among the ones scanned from the input, if any
+  std::size_t tok_idx{no_index};
+  std::string_view arg_name{};
+  // what the error is about as it was in the input (e.g. an unknown subcommand), which is copied because the input may
+  // not outlive the error. Several unknown arguments are listed in one, as in the message.
+  std::string input{};
+  std::string other_input{}; // the other of two conflicting arguments
+  std::size_t expected_amount{0};
+  std::exception_ptr cause{};
+};
+
+// The message of `error`, as returned by `UserError::what`
+[[nodiscard]] std::string format_message(ParseError const &error);
+
+// Base class for exceptions thrown because of errors from the users of the CLI program. The message is only formatted
+// when `what` is first called, so that errors that are handled without being printed cost no formatting. That isn't
+// synchronized, so the same exception object must not be read from several threads at once.
 class UserError : public std::runtime_error {
 public:
 
-  CmdFmt formatter;
+  ParseError error;
+  LazyCmdFmt formatter;
+
+  UserError(ParseError error, LazyCmdFmt formatter)
+    : std::runtime_error(""), error(std::move(error)), formatter(std::move(formatter)) {}
 
-  UserError(std::string const &msg, CmdFmt formatter) : std::runtime_error(msg), formatter(std::move(formatter)) {}
+  [[nodiscard]] char const *what() const noexcept override;
+
+private:
+
+  mutable std::string message;
 };
 
 class MissingRequiredArgument : public UserError {
 public:
 
-  MissingRequiredArgument(std::string_view cmd_name, std::string_view name, CmdFmt const &formatter)
-    : UserError(fmt::format("Missing required argument `{}` for command `{}`", name, cmd_name), formatter) {}
+  using UserError::UserError;
 };
 
 class UnexpectedPositional : public UserError {
 public:
 
-  UnexpectedPositional(
-    std::string_view cmd_name, std::string_view name, std::size_t expected_amount, CmdFmt const &formatter
-  )
-    : UserError(
-        fmt::format(
-          "Unexpected positional argument for `{}`: `{}` (only {} are expected)", cmd_name, name, expected_amount
-        ),
-        formatter
-      ) {}
+  using UserError::UserError;
 };
 
 class UnknownArguments : public UserError {
 public:
 
-  UnknownArguments(
-    std::string_view cmd_name, std::vector<std::string_view> const &unknown_args, CmdFmt const &formatter
-  )
-    : UserError(
-        fmt::format("Unknown arguments for `{}` command: `{}`", cmd_name, fmt::join(unknown_args, "`, `")), formatter
-      ) {}
+  using UserError::UserError;
 };
 
 class UnknownSubcommand : public UserError {
 public:
 
-  UnknownSubcommand(std::string_view cmd_name, std::string_view subcmd_name, CmdFmt const &formatter)
-    : UserError(fmt::format("Unknown subcommand `{}` for command `{}`", subcmd_name, cmd_name), formatter) {}
+  using UserError::UserError;
 };
 
 class ConflictingArguments : public UserError {
 public:
 
-  ConflictingArguments(
-    std::string_view cmd_name, std::string_view arg_name, std::string_view other_arg_name, CmdFmt const &formatter
-  )
-    : UserError(
-        fmt::format(
-          "Arguments `{}` and `{}` for command `{}` are mutually exclusive. Please check help for more details",
-          arg_name,
-          other_arg_name,
-          cmd_name
-        ),
-        formatter
-      ) {}
+  using UserError::UserError;
 };
 
 class MissingAllRequiredGroupedArguments : public UserError {
 public:
 
-  MissingAllRequiredGroupedArguments(std::string_view cmd_name, std::string_view name, CmdFmt const &formatter)
-    : UserError(
-        fmt::format(
-          "Argument `{}` of command `{}` is missing and it is part of a group which requires that either all"
-          " or none of its arguments be present. Please check help for more details",
-          name,
-          cmd_name
-        ),
-        formatter
-      ) {}
+  using UserError::UserError;
 };
 
 class MissingMutuallyExclusiveGroupedArguments : public UserError {
 public:
 
-  MissingMutuallyExclusiveGroupedArguments(std::string_view cmd_name, std::string_view name, CmdFmt const &formatter)
-    : UserError(
-        fmt::format(
-          "Argument `{}` of command `{}` is missing and it is part of a group which requires that exactly"
-          " one of its arguments be present. Please check help for more details",
-          name,
-          cmd_name
-        ),
-        formatter
-      ) {}
+  using UserError::UserError;
 };
 
+// Throws the UserError (or the subclass of it) for the kind of `error`
+[[noreturn]] void throw_user_error(ParseError error, LazyCmdFmt formatter);
+
 // +------------------------------------------+
 // | runtime errors to convert to user errors |
 // +------------------------------------------+
@@ -137,6 +144,17 @@ class ConversionError : public std::runtime_error {
 public:
 
   ConversionError(auto from, auto to) : std::runtime_error(fmt::format("Cannot convert `{}` to `{}`", from, to)) {}
+
+protected:
+
+  explicit ConversionError(std::string const &message) : std::runtime_error(message) {}
+};
+
+class ValueOutOfRange : public ConversionError {
+public:
+
+  ValueOutOfRange(std::string_view value, std::string_view type)
+    : ConversionError(fmt::format("`{}` is out of range for {}", value, type)) {}
 };
 
 class MissingValue : public std::runtime_error {
@@ -148,6 +166,44 @@ public:
       ) {}
 };
 
+class FileError : public std::runtime_error {
+public:
+
+  int error_number; // errno
+
+  FileError(std::string_view path, int error_number)
+    : std::runtime_error(fmt::format("Cannot read `{}`: {}", path, std::strerror(error_number))),
+      error_number(error_number) {}
+};
+
+class ConfigFileError : public std::runtime_error {
+public:
+
+  ConfigFileError(std::string_view path, std::size_t line, std::string_view reason)
+    : std::runtime_error(fmt::format("Invalid config file `{}` at line {}: {}", path, line, reason)) {}
+};
+
+class ResponseFileError : public std::runtime_error {
+public:
+
+  ResponseFileError(std::string_view path, std::string_view reason)
+    : std::runtime_error(fmt::format("Cannot read response file `{}`: {}", path, reason)) {}
+};
+
+class ArgStreamError : public std::runtime_error {
+public:
+
+  ArgStreamError(int fd, std::string_view reason)
+    : std::runtime_error(fmt::format("Cannot read arguments from file descriptor {}: {}", fd, reason)) {}
+};
+
+class CommandLineError : public std::runtime_error {
+public:
+
+  CommandLineError(std::size_t column, std::string_view reason)
+    : std::runtime_error(fmt::format("Invalid command line at column {}: {}", column, reason)) {}
+};
+
 class UnexpectedValue : public std::runtime_error {
 public:
 
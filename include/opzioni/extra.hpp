@@ -1,13 +1,44 @@
 #ifndef OPZIONI_EXTRA_HPP
 #define OPZIONI_EXTRA_HPP
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string_view>
-#include <vector>
 
 namespace opz {
 
+// How many levels of commands there may be, counting the root one, so that the names of the commands above any of them
+// fit in a ParentCmdsNames
+inline constexpr std::size_t max_cmd_depth = 16;
+
+// Names of the commands above the one being parsed, from the root one down. They are kept in place rather than in a
+// vector, so that errors carry a copy of them without allocating.
+class ParentCmdsNames {
+public:
+
+  void push_back(std::string_view const name) noexcept { this->names[this->count++] = name; }
+
+  [[nodiscard]] std::string_view const *begin() const noexcept { return this->names.data(); }
+  [[nodiscard]] std::string_view const *end() const noexcept { return this->names.data() + this->count; }
+  [[nodiscard]] std::size_t size() const noexcept { return this->count; }
+  [[nodiscard]] bool empty() const noexcept { return this->count == 0; }
+
+private:
+
+  std::array<std::string_view, max_cmd_depth - 1> names{};
+  std::size_t count{0};
+};
+
+// What parsing ended with instead of a map (see `ParseOutcome`)
+enum struct OutcomeKind : std::uint8_t { HELP, VERSION, USER_ERROR };
+
 struct ExtraInfo {
-  std::vector<std::string_view> parent_cmds_names;
+  ParentCmdsNames parent_cmds_names;
+  // set by the help and version actions, which leave printing (and exiting) to the caller of parsing, so that parsing
+  // stops there and ends with it
+  mutable std::optional<OutcomeKind> exit_request{};
 };
 
 } // namespace opz
@@ -11,19 +11,14 @@ struct TypeResult {
   using type = T;
 };
 
-// base case (type not found)
+// type not found
 template <FixedString, typename...>
 struct GetType : TypeResult<void> {};
 
-// base case (type found)
-template <FixedString Needle, FixedString... Haystack, typename NeedleType, typename... HaystackTypes>
-struct GetType<Needle, StringList<Needle, Haystack...>, TypeList<NeedleType, HaystackTypes...>>
-  : TypeResult<NeedleType> {};
-
-// recursion case (keep looking)
-template <FixedString Needle, FixedString Other, FixedString... Haystack, typename OtherType, typename... HaystackTypes>
-struct GetType<Needle, StringList<Other, Haystack...>, TypeList<OtherType, HaystackTypes...>>
-  : GetType<Needle, StringList<Haystack...>, TypeList<HaystackTypes...>> {};
+// the type at the index of the name, which is `void` if the name is not in the list
+template <FixedString Needle, FixedString... Haystack, typename... HaystackTypes>
+struct GetType<Needle, StringList<Haystack...>, TypeList<HaystackTypes...>>
+  : TypeAt<IndexOfStr<0, Needle, StringList<Haystack...>>::value, TypeList<HaystackTypes...>> {};
 
 } // namespace opz
 
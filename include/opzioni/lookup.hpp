@@ -0,0 +1,286 @@
+#ifndef OPZIONI_LOOKUP_HPP
+#define OPZIONI_LOOKUP_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "opzioni/fixed_string.hpp"
+#include "opzioni/string_list.hpp"
+
+namespace opz {
+
+// FNV-1a followed by murmur3's finalizer, so that different seeds give independent-looking hashes
+[[nodiscard]] constexpr std::uint32_t hash_str(std::string_view const str, std::uint32_t const seed) noexcept {
+  std::uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (char const ch : str) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 16777619u;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+[[nodiscard]] constexpr int find_in_perfect_hash(
+  std::span<std::string_view const> const keys,
+  std::span<std::uint32_t const> const seeds,
+  std::span<int const> const values,
+  std::string_view const key
+) noexcept {
+  if (keys.empty()) return -1;
+  auto const bucket = hash_str(key, 0) % keys.size();
+  auto const slot = hash_str(key, seeds[bucket]) % keys.size();
+  return keys[slot] == key ? values[slot] : -1;
+}
+
+// +--------------------------------+
+// |          PerfectHash           |
+// +--------------------------------+
+
+// Minimal perfect hash (hash and displace): keys are first spread into N buckets and then each bucket gets a seed that
+// places all of its keys into free slots of a table of exactly N entries. Looking up a key is then two hashes and a
+// single string comparison to reject keys that are not in the table.
+template <std::size_t N>
+struct PerfectHash {
+  std::array<std::string_view, N> keys{}; // in slot order
+  std::array<std::uint32_t, N> seeds{};   // one per bucket
+  std::array<int, N> values{};            // slot -> index of the key in the original list
+
+  [[nodiscard]] constexpr int find(std::string_view const key) const noexcept {
+    return find_in_perfect_hash(this->keys, this->seeds, this->values, key);
+  }
+};
+
+template <std::size_t N>
+constexpr PerfectHash<N> make_perfect_hash(std::array<std::string_view, N> const &keys) {
+  PerfectHash<N> ph;
+  if constexpr (N > 0) {
+    // counting sort of the keys by bucket, so that trying a seed only touches the keys of that bucket
+    std::array<std::size_t, N + 1> bucket_offsets{};
+    for (auto const key : keys) {
+      bucket_offsets[hash_str(key, 0) % N + 1] += 1;
+    }
+    for (std::size_t b = 0; b < N; ++b) {
+      bucket_offsets[b + 1] += bucket_offsets[b];
+    }
+    std::array<std::size_t, N> bucket_keys{};
+    auto fill_pos = bucket_offsets;
+    for (std::size_t i = 0; i < N; ++i) {
+      bucket_keys[fill_pos[hash_str(keys[i], 0) % N]++] = i;
+    }
+
+    // place the biggest buckets first, while there are still many free slots
+    std::array<std::size_t, N> order{};
+    for (std::size_t b = 0; b < N; ++b) {
+      order[b] = b;
+    }
+    std::ranges::sort(order, [&bucket_offsets](std::size_t const lhs, std::size_t const rhs) {
+      auto const lhs_size = bucket_offsets[lhs + 1] - bucket_offsets[lhs];
+      auto const rhs_size = bucket_offsets[rhs + 1] - bucket_offsets[rhs];
+      return lhs_size > rhs_size || (lhs_size == rhs_size && lhs < rhs);
+    });
+
+    std::array<bool, N> taken{};
+    for (auto const bucket : order) {
+      auto const first = bucket_offsets[bucket], last = bucket_offsets[bucket + 1];
+      if (first == last) break; // all remaining buckets are empty too
+      std::array<std::size_t, N> slots{};
+      for (std::uint32_t seed = 1;; ++seed) {
+        if (seed > (1u << 16)) throw "Could not build a perfect hash for the argument names (are there duplicates?)";
+        bool placed = true;
+        for (std::size_t k = 0; placed && k < last - first; ++k) {
+          slots[k] = hash_str(keys[bucket_keys[first + k]], seed) % N;
+          auto const prev_slots = std::span(slots).first(k);
+          placed = !taken[slots[k]] && std::ranges::find(prev_slots, slots[k]) == prev_slots.end();
+        }
+        if (!placed) continue;
+        for (std::size_t k = 0; k < last - first; ++k) {
+          taken[slots[k]] = true;
+          ph.keys[slots[k]] = keys[bucket_keys[first + k]];
+          ph.values[slots[k]] = static_cast<int>(bucket_keys[first + k]);
+        }
+        ph.seeds[bucket] = seed;
+        break;
+      }
+    }
+  }
+  return ph;
+}
+
+// +--------------------------------+
+// |           ArgLookup            |
+// +--------------------------------+
+
+// Non-owning view of an ArgLookup, so that code outside of templates can resolve tokens regardless of argument count
+struct ArgLookupView {
+  std::span<std::string_view const> keys;
+  std::span<std::uint32_t const> seeds;
+  std::span<int const> values;
+  std::span<std::int16_t const, 128> abbrevs;
+
+  [[nodiscard]] constexpr std::size_t size() const noexcept { return this->keys.size(); }
+
+  [[nodiscard]] constexpr int find_name(std::string_view const name) const noexcept {
+    return find_in_perfect_hash(this->keys, this->seeds, this->values, name);
+  }
+
+  [[nodiscard]] constexpr int find_abbrev(char const abbrev) const noexcept {
+    auto const idx = static_cast<unsigned char>(abbrev);
+    return idx < this->abbrevs.size() ? this->abbrevs[idx] : -1;
+  }
+};
+
+// Resolves the name or abbreviation of a token to the index of the argument in its command, in constant time
+template <std::size_t N>
+struct ArgLookup {
+  PerfectHash<N> names;
+  std::array<std::int16_t, 128> abbrevs; // abbreviations are always a single ASCII character
+
+  [[nodiscard]] constexpr int find_name(std::string_view const name) const noexcept { return this->names.find(name); }
+
+  [[nodiscard]] constexpr int find_abbrev(char const abbrev) const noexcept { return this->view().find_abbrev(abbrev); }
+
+  [[nodiscard]] constexpr ArgLookupView view() const noexcept {
+    return {
+      .keys = this->names.keys, .seeds = this->names.seeds, .values = this->names.values, .abbrevs = this->abbrevs
+    };
+  }
+};
+
+template <std::size_t N>
+constexpr ArgLookup<N>
+make_arg_lookup(std::array<std::string_view, N> const &names, std::array<std::string_view, N> const &abbrevs) {
+  static_assert(N <= INT16_MAX, "Too many arguments in a single command");
+  ArgLookup<N> lookup{.names = make_perfect_hash(names), .abbrevs{}};
+  lookup.abbrevs.fill(-1);
+  for (std::size_t i = 0; i < N; ++i) {
+    if (abbrevs[i].empty()) continue;
+    auto const idx = static_cast<unsigned char>(abbrevs[i][0]);
+    if (idx >= lookup.abbrevs.size()) throw "Argument abbreviations must be ASCII characters";
+    lookup.abbrevs[idx] = static_cast<std::int16_t>(i);
+  }
+  return lookup;
+}
+
+template <typename...> struct ArgLookupOf;
+template <FixedString... Names, FixedString... Abbrevs>
+struct ArgLookupOf<StringList<Names...>, StringList<Abbrevs...>> {
+  static constexpr auto value = make_arg_lookup<sizeof...(Names)>(
+    {std::string_view(Names)...}, {std::string_view(Abbrevs)...}
+  );
+};
+
+// +--------------------------------+
+// |          SubcmdLookup          |
+// +--------------------------------+
+
+// Most aliases that a single command may have, which bounds the size of the SubcmdLookup of its parent
+inline constexpr std::size_t max_cmd_aliases = 3;
+
+// Resolves the name or an alias of a subcommand to its index among the `N` subcommands of a command. It is rebuilt
+// each time a subcommand is added (which happens at compile time), so it is an open addressing table rather than a
+// PerfectHash: adding keys only needs their hashes, which are kept. Looking up a name then hashes it once and compares
+// the strings of the few keys in its probe sequence, with at least half of the slots always empty.
+template <std::size_t N>
+struct SubcmdLookup {
+  static constexpr std::size_t max_keys = N * (1 + max_cmd_aliases);
+  static constexpr std::size_t capacity = std::bit_ceil(2 * max_keys);
+
+  std::array<std::string_view, max_keys> keys{}; // names and aliases, in the order that they were added
+  std::array<std::uint32_t, max_keys> hashes{};
+  std::array<std::int16_t, max_keys> values{}; // key -> index of the subcommand
+  std::array<std::int16_t, max_keys> sorted{}; // indices of the keys in lexicographic order of the keys
+  std::array<std::int16_t, capacity> slots{};  // slot -> index of the key, or -1 if empty
+  std::size_t size{0};
+
+  [[nodiscard]] constexpr int find(std::string_view const name) const noexcept {
+    if constexpr (N == 0) return -1;
+    else {
+      auto const hash = hash_str(name, 0);
+      for (auto slot = hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1)) {
+        auto const key_idx = this->slots[slot];
+        if (key_idx == -1) return -1;
+        if (this->hashes[key_idx] == hash && this->keys[key_idx] == name) return this->values[key_idx];
+      }
+    }
+  }
+
+  // Index of the only subcommand that has a name or alias starting with `prefix`, or -1 if there are none or many. Its
+  // keys are next to each other once sorted, so this is a binary search followed by at most one key per alias.
+  [[nodiscard]] constexpr int find_prefix(std::string_view const prefix) const noexcept {
+    if (prefix.empty()) return -1;
+    auto const sorted_keys = std::span(this->sorted).first(this->size);
+    auto it = std::ranges::lower_bound(sorted_keys, prefix, {}, [this](std::int16_t const key_idx) {
+      return this->keys[key_idx];
+    });
+    int found = -1;
+    for (; it != sorted_keys.end() && this->keys[*it].starts_with(prefix); ++it) {
+      if (found != -1 && found != this->values[*it]) return -1;
+      found = this->values[*it];
+    }
+    return found;
+  }
+};
+
+// The lookup of `prev` with one more subcommand, called `name` or any of the non-empty `aliases`
+template <std::size_t N>
+constexpr SubcmdLookup<N> make_subcmd_lookup(
+  SubcmdLookup<N - 1> const &prev,
+  std::string_view const name,
+  std::array<std::string_view, max_cmd_aliases> const aliases
+) {
+  static_assert(SubcmdLookup<N>::max_keys <= INT16_MAX, "Too many subcommands in a single command");
+  constexpr auto mask = SubcmdLookup<N>::capacity - 1;
+  SubcmdLookup<N> lookup;
+  lookup.slots.fill(-1);
+  auto const add = [&lookup](std::string_view const key, std::uint32_t const hash, std::int16_t const value) {
+    auto slot = hash & mask;
+    for (; lookup.slots[slot] != -1; slot = (slot + 1) & mask) {
+      auto const other_idx = lookup.slots[slot];
+      if (lookup.hashes[other_idx] == hash && lookup.keys[other_idx] == key)
+        throw "Subcommand with this name or alias already exists";
+    }
+    auto const key_idx = lookup.size++;
+    lookup.keys[key_idx] = key;
+    lookup.hashes[key_idx] = hash;
+    lookup.values[key_idx] = value;
+    lookup.slots[slot] = static_cast<std::int16_t>(key_idx);
+  };
+
+  for (std::size_t i = 0; i < prev.size; ++i) {
+    add(prev.keys[i], prev.hashes[i], prev.values[i]);
+    lookup.sorted[i] = prev.sorted[i];
+  }
+  add(name, hash_str(name, 0), static_cast<std::int16_t>(N - 1));
+  for (auto const alias : aliases) {
+    if (!alias.empty()) add(alias, hash_str(alias, 0), static_cast<std::int16_t>(N - 1));
+  }
+
+  // insertion sort of the new keys into the already sorted ones
+  for (auto key_idx = prev.size; key_idx < lookup.size; ++key_idx) {
+    auto const sorted_keys = std::span(lookup.sorted).first(key_idx);
+    auto const pos = static_cast<std::size_t>(
+      std::ranges::lower_bound(
+        sorted_keys, lookup.keys[key_idx], {}, [&lookup](std::int16_t const idx) { return lookup.keys[idx]; }
+      ) -
+      sorted_keys.begin()
+    );
+    for (auto i = key_idx; i > pos; --i) {
+      lookup.sorted[i] = lookup.sorted[i - 1];
+    }
+    lookup.sorted[pos] = static_cast<std::int16_t>(key_idx);
+  }
+  return lookup;
+}
+
+} // namespace opz
+
+#endif // OPZIONI_LOOKUP_HPP
@@ -0,0 +1,40 @@
+#ifndef OPZIONI_OUTCOME_HPP
+#define OPZIONI_OUTCOME_HPP
+
+#include <cstdio>
+#include <expected>
+#include <string>
+
+#include "opzioni/cmd_fmt.hpp"
+#include "opzioni/exceptions.hpp"
+#include "opzioni/extra.hpp"
+
+namespace opz {
+
+// Why parsing didn't result in a map: the user asked for help or the version, or made a mistake. Nothing was printed
+// yet, so the caller decides whether and where to (e.g. a service may reply with it instead of writing to a terminal).
+struct ParseOutcome {
+  OutcomeKind kind;
+  ParseError error; // what the mistake was, only for USER_ERROR
+  LazyCmdFmt formatter; // of the (sub)command that the outcome is about
+
+  [[nodiscard]] bool is_error() const noexcept { return this->kind == OutcomeKind::USER_ERROR; }
+
+  // The message of the error (see `UserError::what`), formatted now; empty for help and version
+  [[nodiscard]] std::string message() const;
+
+  // Prints what parsing with `Cmd::operator()` would have: the help page or the version to `out`, or the error and the
+  // usage to `err`. Returns the exit code that it would have exited with.
+  int print(std::FILE *out = stdout, std::FILE *err = stderr) const noexcept;
+
+  // What the throwing ways of parsing (e.g. `CmdParser::operator()`) do with the outcome: throw the error as a
+  // UserError, or print the help page or the version and exit
+  [[noreturn]] void raise() const;
+};
+
+// Result of the parsing steps, which stop at the first outcome other than a map instead of throwing it
+using ParseResult = std::expected<void, ParseOutcome>;
+
+} // namespace opz
+
+#endif // OPZIONI_OUTCOME_HPP
@@ -0,0 +1,207 @@
+#ifndef OPZIONI_PARSER_CORE_HPP
+#define OPZIONI_PARSER_CORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <expected>
+#include <map>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "opzioni/actions.hpp"
+#include "opzioni/arg.hpp"
+#include "opzioni/arg_stream.hpp"
+#include "opzioni/cmd_fmt.hpp"
+#include "opzioni/command_line.hpp"
+#include "opzioni/concepts.hpp"
+#include "opzioni/config_file.hpp"
+#include "opzioni/exceptions.hpp"
+#include "opzioni/extra.hpp"
+#include "opzioni/outcome.hpp"
+#include "opzioni/response_file.hpp"
+#include "opzioni/scanner.hpp"
+#include "opzioni/schema.hpp"
+#include "opzioni/token_bitset.hpp"
+
+namespace opz {
+
+class ParserCore;
+
+// What depends on the type of an argument, as functions of the ArgsMap (`ArgsMap<Cmd const> *`) and of the command
+// (`Cmd const *`) that it belongs to
+struct ArgOps {
+  // converts `value` into the value of the argument
+  void (*consume)(void *map, void const *cmd, act::ArgValue const &value, ExtraInfo const &extra_info);
+  // sets the value of the argument to its default value, which it must have
+  void (*set_default)(void *map, void const *cmd);
+  // whether its values may be kept to be converted when first accessed (see `ExtraConfig::lazy_conversion`)
+  bool is_deferrable;
+  // whether it takes all values that it is given (APPEND) rather than a single one
+  bool takes_many;
+};
+
+// +-----------------------+
+// |        CmdDesc        |
+// +-----------------------+
+
+// What ParserCore needs from a command object. Two commands of the same type may still differ in these (e.g. in the
+// name or in which arguments are required), so they are read from the object through its CmdDesc.
+struct CmdView {
+  std::string_view name;
+  std::string_view env_prefix;
+  bool lazy_conversion;
+  std::optional<ResponseFileConfig> response_files;
+  std::span<ArgDesc const> args; // see `Cmd::arg_descs`
+};
+
+// Table of constants and functions that describes a type of command, which is all that ParserCore needs from the type.
+// There is one per command type, so that the parsing itself is compiled once instead of once for each of them.
+struct CmdDesc {
+  CmdSchema const *schema;
+  std::span<ArgOps const> args;
+  // indices of the positionals among all arguments, in the order that they are expected in the command line
+  std::span<std::size_t const> pos_slots;
+  // perfect hash of the names of the environment variables derived from the argument names (see `EnvNamesOf`)
+  std::span<std::string_view const> env_keys;
+  std::span<std::uint32_t const> env_seeds;
+  std::span<int const> env_values;
+  bool has_subcmds;
+
+  // what the command object (rather than its type) has for parsing, which the ArgDescs of its arguments are part of
+  CmdView (*view)(void const *cmd) noexcept;
+  // prepares the map of the command to receive the values of its arguments
+  void (*init_map)(void *map, void const *cmd, std::string_view exec_path) noexcept;
+  void (*set_origin)(void *map, std::size_t arg_idx, ArgOrigin origin) noexcept;
+  void (*defer_conversion)(void *map, std::size_t arg_idx, std::span<std::string_view const> values);
+  // parses the subcommand at `tok_idx` (whose index among the subcommands is `subcmd_idx`) into the submap of `map`
+  ParseResult (*parse_subcmd)(
+    void *map,
+    void const *cmd,
+    int subcmd_idx,
+    ParserCore const &parent,
+    std::span<std::string_view const> args,
+    std::span<Token const> tokens,
+    std::size_t tok_idx
+  );
+  LazyCmdFmt (*get_cmd_fmt)(void const *cmd, ExtraInfo const &extra_info);
+};
+
+// +-----------------------+
+// |      ParserCore       |
+// +-----------------------+
+
+// An argument of a group that got a value, as it is named in the error if another one of a mutually exclusive group
+// gets one too: how it was written in the command line, or its name if it came from a fallback
+struct GroupMember {
+  std::string_view id;
+  ArgOrigin origin;
+};
+
+// Parses the arguments of one command into its ArgsMap, through its CmdDesc and a type-erased pointer to the map. It is
+// not a template, so it is compiled once in the library, while CmdParser is just a typed facade over it.
+// Errors of the user, as well as asking for help or the version, are returned rather than thrown. Only the conversions
+// of values (which are user code that reports errors by throwing) and the reading of files and streams throw, which is
+// caught right around them and returned as an INVALID_INPUT error.
+class ParserCore {
+public:
+
+  ExtraInfo extra_info;
+
+  ParserCore(CmdDesc const &desc, void const *cmd, std::pmr::memory_resource *mem_resource);
+  // The core of a subcommand of the command of `parent`
+  ParserCore(CmdDesc const &desc, void const *cmd, ParserCore const &parent);
+
+  [[nodiscard]] std::pmr::memory_resource *get_mem_resource() const noexcept { return this->mem_resource; }
+  [[nodiscard]] LazyCmdFmt get_cmd_fmt() const { return this->desc->get_cmd_fmt(this->cmd, this->extra_info); }
+
+  [[nodiscard]] ParseResult rescan(Scanner &scanner, std::span<char const *> args) const;
+  [[nodiscard]] ParseResult rescan(Scanner &scanner, CommandLine &command_line, std::string_view line) const;
+  // Scans the arguments read from `stream`, until its end, after the ones already in `scanner`
+  [[nodiscard]] ParseResult scan_stream(Scanner &scanner, ArgStream &stream) const;
+  // Reads the entries of `config` for the arguments that are not in the command line (nor in the environment). The
+  // mapping of the file, if any, has to outlive the values parsed from it.
+  [[nodiscard]] std::expected<std::optional<MappedFile>, ParseOutcome> load_config(ConfigFile const &config);
+
+  // Parses the tokens of `scanner` into `map`, which must be empty
+  [[nodiscard]] ParseResult parse(void *map, Scanner &scanner);
+  // Parses the tokens of this command, which start with the one at `recursion_start_idx` (its name), into `map`
+  [[nodiscard]] ParseResult fill_args_map(
+    void *map, std::span<std::string_view const> args, std::span<Token const> tokens, std::size_t recursion_start_idx
+  );
+
+private:
+
+  CmdDesc const *desc;
+  void const *cmd;
+  std::string_view cmd_name;
+  std::string_view env_prefix;
+  bool lazy_conversion;
+  std::optional<ResponseFileConfig> response_files;
+  std::pmr::memory_resource *mem_resource;
+  std::span<ArgDesc const> args;
+  // whether each argument got a value so far
+  std::pmr::vector<bool> with_value;
+  // the first argument of each group that got a value, from the command line or from a fallback
+  std::pmr::map<std::uint_least32_t, GroupMember> parsed_group_members;
+  ConfigLayer config{};
+  std::pmr::vector<ConfigEntry> config_entries; // only those of the root command, which `config` may point into
+
+  void inherit_from(ParserCore const &parent);
+
+  [[nodiscard]] ParseResult parse_subcmd(
+    void *map,
+    std::span<std::string_view const> args,
+    std::span<Token const> tokens,
+    std::size_t recursion_start_idx,
+    std::size_t recursion_end_idx
+  ) const;
+  [[nodiscard]] ParseResult process_tokens(
+    void *map,
+    std::span<Token const> tokens,
+    std::size_t recursion_start_idx,
+    std::size_t recursion_end_idx,
+    TokenBitset &consumed_indices
+  );
+  [[nodiscard]] ParseResult consume_from_tokens(
+    void *map, std::size_t arg_idx, std::span<Token const> tokens, TokenIndices const &indices, std::size_t tok_idx
+  );
+  [[nodiscard]] std::expected<bool, ParseOutcome>
+  defer_if_lazy(void *map, std::size_t arg_idx, std::span<std::string_view const> values);
+  [[nodiscard]] ParseResult consume_or_defer(void *map, std::size_t arg_idx, std::string_view value);
+  [[nodiscard]] ParseResult
+  consume_or_defer(void *map, std::size_t arg_idx, std::pmr::vector<std::string_view> const &values);
+
+  [[nodiscard]] std::pmr::vector<std::optional<std::string_view>> read_env_values() const;
+  [[nodiscard]] std::pmr::vector<std::string_view> env_values_of(std::optional<std::string_view> env_value) const;
+  [[nodiscard]] std::expected<std::pmr::vector<Token>, ParseOutcome> get_config_tokens() const;
+  [[nodiscard]] std::pmr::vector<std::string_view>
+  config_values_of(std::span<Token const> config_tokens, std::span<std::size_t const> occurrences) const;
+  [[nodiscard]] ParseResult consume_fallback(
+    void *map, std::size_t arg_idx, std::pmr::vector<std::string_view> const &values, ArgOrigin origin
+  );
+
+  [[nodiscard]] ParseResult post_process_arg(
+    std::size_t arg_idx, std::span<Token const> tokens, TokenIndices const &indices, std::size_t &cur_pos_idx
+  );
+  [[nodiscard]] ParseResult check_missing_arg(void *map, std::size_t arg_idx);
+  [[nodiscard]] ParseResult check_unknown_args(
+    std::span<std::string_view const> args, std::span<Token const> tokens, TokenBitset const &consumed_indices
+  ) const;
+
+  // Ends parsing with `error` as a user error of this command
+  [[nodiscard]] std::unexpected<ParseOutcome> fail(ParseError error) const;
+  // Ends parsing with help or the version if an action asked for it
+  [[nodiscard]] ParseResult check_exit_request() const;
+  [[nodiscard]] ParseError
+  invalid_input(std::exception_ptr cause, std::size_t arg_idx = no_index, std::size_t tok_idx = no_index) const;
+  [[nodiscard]] ParseError missing(ErrorKind kind, std::size_t arg_idx) const;
+  [[nodiscard]] ParseError conflict(std::size_t arg_idx, std::string_view id, std::string_view other_id) const;
+};
+
+} // namespace opz
+
+#endif // OPZIONI_PARSER_CORE_HPP
@@ -2,60 +2,310 @@
 #define OPZIONI_PARSING_HPP
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
+#include <expected>
 #include <functional>
-#include <map>
-#include <set>
+#include <memory_resource>
 #include <span>
 #include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "opzioni/actions.hpp"
 #include "opzioni/arg.hpp"
+#include "opzioni/arg_stream.hpp"
 #include "opzioni/args_map.hpp"
 #include "opzioni/cmd_fmt.hpp"
+#include "opzioni/command_line.hpp"
 #include "opzioni/concepts.hpp"
+#include "opzioni/config_file.hpp"
+#include "opzioni/env.hpp"
 #include "opzioni/exceptions.hpp"
+#include "opzioni/lookup.hpp"
+#include "opzioni/outcome.hpp"
+#include "opzioni/parser_core.hpp"
 #include "opzioni/scanner.hpp"
+#include "opzioni/schema.hpp"
 
 namespace opz {
 
-template <concepts::Cmd... Cmds>
-[[nodiscard]] constexpr int
-find_cmd(std::tuple<std::reference_wrapper<Cmds const> const...> const haystack, std::string_view const name) {
-  // clang-format off
-  return std::apply(
-    [name](auto &&...elem) {
-      int idx = 0, ret = -1;
-      (void) // cast to void to suppress unused warning
-      ((elem.get().name == name ? (ret = idx, true) : (++idx, false)) || ...);
-      return ret;
-    },
-    haystack);
-  // clang-format on
-}
+// +-----------------------+
+// |      CmdSchemaOf      |
+// +-----------------------+
+
+template <concepts::Cmd Cmd>
+struct CmdSchemaOf {
+  // schema of the subcommand that a `std::reference_wrapper<SubCmd const>` refers to
+  template <typename SubCmdRef>
+  using SubCmdSchemaOf = CmdSchemaOf<std::remove_const_t<typename std::remove_reference_t<SubCmdRef>::type>>;
+
+  static int find_subcmd(void const *cmd, std::string_view const name) noexcept {
+    return static_cast<Cmd const *>(cmd)->find_subcmd(name);
+  }
+
+  template <std::size_t I>
+  static CmdRef get_ith_subcmd(void const *cmd) noexcept {
+    auto const &subcmd = std::get<I>(static_cast<Cmd const *>(cmd)->subcmds);
+    return CmdRef{&subcmd.get(), &SubCmdSchemaOf<decltype(subcmd)>::value};
+  }
+
+  // jump table from the index of a subcommand to the function that gets it
+  static constexpr auto subcmd_getters = []<std::size_t... Is>(std::index_sequence<Is...>) {
+    return std::array<CmdRef (*)(void const *) noexcept, sizeof...(Is)>{&CmdSchemaOf::get_ith_subcmd<Is>...};
+  }(std::make_index_sequence<std::tuple_size_v<decltype(Cmd::subcmds)>>());
+
+  static CmdRef get_subcmd(void const *cmd, int const idx) noexcept {
+    return subcmd_getters[static_cast<std::size_t>(idx)](cmd);
+  }
+
+  static constexpr CmdSchema value{
+    .lookup = ArgLookupOf<typename Cmd::arg_names, typename Cmd::arg_abbrevs>::value.view(),
+    .kinds = ArrayOf<typename Cmd::arg_kinds>::value,
+    .find_subcmd = &CmdSchemaOf::find_subcmd,
+    .get_subcmd = &CmdSchemaOf::get_subcmd,
+  };
+};
+
+template <concepts::Cmd>
+class CmdParser;
+
+// +-----------------------+
+// |       CmdDescOf       |
+// +-----------------------+
+
+// The CmdDesc of a command type, whose functions are the only code that each type of command needs for parsing
+template <concepts::Cmd Cmd>
+struct CmdDescOf {
+  using map_type = ArgsMap<Cmd const>;
+
+  static constexpr auto args_size = std::tuple_size_v<decltype(Cmd::args)>;
+  static constexpr auto const &arg_kinds = ArrayOf<typename Cmd::arg_kinds>::value;
+  static constexpr auto pos_slots = [] {
+    std::array<std::size_t, std::ranges::count(arg_kinds, ArgKind::POS)> slots{};
+    for (std::size_t arg_idx = 0, pos_idx = 0; arg_idx < args_size; ++arg_idx) {
+      if (arg_kinds[arg_idx] == ArgKind::POS) slots[pos_idx++] = arg_idx;
+    }
+    return slots;
+  }();
+
+  template <std::size_t I>
+  using tag_type_of = typename std::remove_cvref_t<std::tuple_element_t<I, decltype(Cmd::args)>>::tag_type;
+
+  // Arguments that are converted from their values, as opposed to flags (which are counted) and to arguments whose
+  // values are already what they would be converted into
+  template <std::size_t I>
+  static constexpr bool is_deferrable = [] {
+    using arg_type = std::remove_cvref_t<std::tuple_element_t<I, decltype(Cmd::args)>>;
+    using tag_type = tag_type_of<I>;
+    return arg_kinds[I] != ArgKind::FLG && !std::is_same_v<typename arg_type::value_type, std::string_view> &&
+           (std::is_same_v<tag_type, act::assign> || std::is_same_v<tag_type, act::append> ||
+            act::is_csv<tag_type>);
+  }();
+
+  template <std::size_t I>
+  static void consume_ith(void *map, void const *cmd, act::ArgValue const &value, ExtraInfo const &extra_info) {
+    auto const &command = *static_cast<Cmd const *>(cmd);
+    // unqualified, so that custom actions are found through their tag too
+    consume_arg<I>(*static_cast<map_type *>(map), std::get<I>(command.args), value, command, extra_info);
+  }
+
+  template <std::size_t I>
+  static void set_default_ith(void *map, void const *cmd) {
+    auto &args_map = *static_cast<map_type *>(map);
+    auto const &arg = std::get<I>(static_cast<Cmd const *>(cmd)->args);
+    using T = std::remove_cvref_t<decltype(*arg.default_value)>;
+    std::get<I>(args_map.args).emplace(
+      arg.default_value ? args_map.template make_value<T>(*arg.default_value) : args_map.template make_value<T>()
+    );
+  }
+
+  static constexpr auto arg_ops = []<std::size_t... Is>(std::index_sequence<Is...>) {
+    return std::array<ArgOps, args_size>{ArgOps{
+      .consume = &CmdDescOf::consume_ith<Is>,
+      .set_default = &CmdDescOf::set_default_ith<Is>,
+      .is_deferrable = is_deferrable<Is>,
+      .takes_many = std::is_same_v<tag_type_of<Is>, act::append>,
+    }...};
+  }(std::make_index_sequence<args_size>());
+
+  // Converts the values of an argument whose conversion was deferred with the same function that parsing would have
+  static void convert_deferred(map_type const &map, std::size_t const idx) {
+    // only the values of the map are written, which are mutable
+    auto &args_map = const_cast<map_type &>(map);
+    auto const raw_values = map.raw_values_of(idx);
+    ExtraInfo const extra_info{};
+    if (arg_kinds[idx] == ArgKind::POS) {
+      arg_ops[idx].consume(&args_map, map.cmd, raw_values.front(), extra_info);
+    } else {
+      std::pmr::vector<std::string_view> const values(raw_values.begin(), raw_values.end(), map.mem_resource);
+      arg_ops[idx].consume(&args_map, map.cmd, std::cref(values), extra_info);
+    }
+  }
+
+  static CmdView view(void const *cmd) noexcept {
+    auto const &command = *static_cast<Cmd const *>(cmd);
+    return CmdView{
+      .name = command.name,
+      .env_prefix = command.env_prefix,
+      .lazy_conversion = command.lazy_conversion,
+      .response_files = command.response_files,
+      .args = command.arg_descs,
+    };
+  }
+
+  static void init_map(void *map, void const *cmd, std::string_view const exec_path) noexcept {
+    auto &args_map = *static_cast<map_type *>(map);
+    args_map.exec_path = exec_path;
+    args_map.converter = &CmdDescOf::convert_deferred;
+    args_map.cmd = static_cast<Cmd const *>(cmd);
+  }
+
+  static void set_origin(void *map, std::size_t const arg_idx, ArgOrigin const origin) noexcept {
+    static_cast<map_type *>(map)->set_origin(arg_idx, origin);
+  }
+
+  static void defer_conversion(void *map, std::size_t const arg_idx, std::span<std::string_view const> const values) {
+    static_cast<map_type *>(map)->defer_conversion(arg_idx, values);
+  }
+
+  template <std::size_t I>
+  static ParseResult parse_ith_subcmd(
+    void *map,
+    void const *cmd,
+    ParserCore const &parent,
+    std::span<std::string_view const> const args,
+    std::span<Token const> const tokens,
+    std::size_t const tok_idx
+  ) {
+    auto const &subcmd = std::get<I>(static_cast<Cmd const *>(cmd)->subcmds);
+    auto submap = CmdParser<typename std::remove_cvref_t<decltype(subcmd)>::type>(subcmd.get(), parent)
+                    .get_args_map(args, tokens, tok_idx);
+    if (!submap) return std::unexpected(std::move(submap.error()));
+    static_cast<map_type *>(map)->submap = std::move(*submap);
+    return {};
+  }
+
+  // jump table from the index of a subcommand to the function that parses it, so that dispatching to one of many
+  // subcommands costs the same as to one of a few
+  static constexpr auto subcmd_parsers = []<std::size_t... Is>(std::index_sequence<Is...>) {
+    using ParseIthSubcmd = ParseResult (*)(
+      void *, void const *, ParserCore const &, std::span<std::string_view const>, std::span<Token const>, std::size_t
+    );
+    return std::array<ParseIthSubcmd, sizeof...(Is)>{&CmdDescOf::parse_ith_subcmd<Is>...};
+  }(std::make_index_sequence<std::tuple_size_v<decltype(Cmd::subcmds)>>());
+
+  static ParseResult parse_subcmd(
+    void *map,
+    void const *cmd,
+    int const subcmd_idx,
+    ParserCore const &parent,
+    std::span<std::string_view const> const args,
+    std::span<Token const> const tokens,
+    std::size_t const tok_idx
+  ) {
+    return subcmd_parsers[static_cast<std::size_t>(subcmd_idx)](map, cmd, parent, args, tokens, tok_idx);
+  }
+
+  static LazyCmdFmt get_cmd_fmt(void const *cmd, ExtraInfo const &extra_info) {
+    return LazyCmdFmt(*static_cast<Cmd const *>(cmd), extra_info);
+  }
+
+  static constexpr CmdDesc value{
+    .schema = &CmdSchemaOf<Cmd>::value,
+    .args = arg_ops,
+    .pos_slots = pos_slots,
+    .env_keys = EnvNamesOf<typename Cmd::arg_names>::value.keys,
+    .env_seeds = EnvNamesOf<typename Cmd::arg_names>::value.seeds,
+    .env_values = EnvNamesOf<typename Cmd::arg_names>::value.values,
+    .has_subcmds = std::tuple_size_v<decltype(Cmd::subcmds)> > 0,
+    .view = &CmdDescOf::view,
+    .init_map = &CmdDescOf::init_map,
+    .set_origin = &CmdDescOf::set_origin,
+    .defer_conversion = &CmdDescOf::defer_conversion,
+    .parse_subcmd = &CmdDescOf::parse_subcmd,
+    .get_cmd_fmt = &CmdDescOf::get_cmd_fmt,
+  };
+};
 
 // +-----------------------+
 // |       CmdParser       |
 // +-----------------------+
 
+// Typed facade over ParserCore, which does the parsing through the CmdDesc of the command
 template <concepts::Cmd Cmd>
 class CmdParser {
 public:
 
   using cmd_type = Cmd;
+  using result_type = std::expected<ArgsMap<Cmd const>, ParseOutcome>;
 
   std::reference_wrapper<Cmd const> cmd_ref;
-  ExtraInfo extra_info;
+  ParserCore core;
+
+  // All memory needed while parsing, as well as the memory of allocator-aware values in the resulting map, comes from
+  // `mem_resource`, so that parsing with e.g. a `std::pmr::monotonic_buffer_resource` doesn't touch the global heap
+  explicit CmdParser(Cmd const &cmd, std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource())
+    : cmd_ref(cmd), core(desc, &cmd, mem_resource) {}
 
-  explicit CmdParser(Cmd const &cmd) : cmd_ref(cmd) {}
+  // Each way of parsing throws errors as UserError, and prints help or the version and exits, through the one below it
+  // that returns them instead (see `ParseOutcome::raise`)
 
   [[nodiscard]] ArgsMap<Cmd const> operator()(std::span<char const *> const args) {
-    auto scanner = Scanner(args);
-    auto const tokens = scanner();
-    auto const indices = index_tokens(tokens);
-    auto map = this->get_args_map(args, tokens, indices, 0, tokens.size() - 1);
+    return value_or_raise(this->try_parse(args));
+  }
+
+  [[nodiscard]] result_type try_parse(std::span<char const *> const args) {
+    Scanner scanner(this->core.get_mem_resource());
+    if (auto result = this->core.rescan(scanner, args); !result) return std::unexpected(std::move(result.error()));
+    return this->parse(scanner);
+  }
+
+  // Parses the arguments read from `stream` (until its end) after the ones in `args`, which may be just the program
+  // name. Arguments are scanned as they are read.
+  [[nodiscard]] ArgsMap<Cmd const> operator()(std::span<char const *> const args, ArgStream &&stream) {
+    return value_or_raise(this->try_parse(args, std::move(stream)));
+  }
+
+  [[nodiscard]] result_type try_parse(std::span<char const *> const args, ArgStream &&stream) {
+    Scanner scanner(this->core.get_mem_resource());
+    if (auto result = this->core.rescan(scanner, args); !result) return std::unexpected(std::move(result.error()));
+    if (auto result = this->core.scan_stream(scanner, stream); !result)
+      return std::unexpected(std::move(result.error()));
+    auto map = this->parse(scanner);
+    if (map) map->arg_stream.emplace(std::move(stream));
+    return map;
+  }
+
+  // Parses `args` with values from `config` for the arguments that are not in the command line (nor in the environment)
+  [[nodiscard]] ArgsMap<Cmd const> operator()(std::span<char const *> const args, ConfigFile const &config) {
+    return value_or_raise(this->try_parse(args, config));
+  }
+
+  [[nodiscard]] result_type try_parse(std::span<char const *> const args, ConfigFile const &config) {
+    Scanner scanner(this->core.get_mem_resource());
+    if (auto result = this->core.rescan(scanner, args); !result) return std::unexpected(std::move(result.error()));
+    auto file = this->core.load_config(config);
+    if (!file) return std::unexpected(std::move(file.error()));
+    auto map = this->parse(scanner);
+    if (map && *file) map->mapped_files.push_back(std::move(**file));
+    return map;
+  }
+
+  // Parses a command string (see `CommandLine`), which must outlive the returned map. Since it doesn't have the program
+  // name, the name of the command takes its place.
+  [[nodiscard]] ArgsMap<Cmd const> operator()(std::string_view const line) {
+    return value_or_raise(this->try_parse(line));
+  }
+
+  [[nodiscard]] result_type try_parse(std::string_view const line) {
+    CommandLine command_line(this->core.get_mem_resource());
+    Scanner scanner(this->core.get_mem_resource());
+    if (auto result = this->core.rescan(scanner, command_line, line); !result)
+      return std::unexpected(std::move(result.error()));
+    auto map = this->parse(scanner);
+    if (map) map->command_line.emplace(std::move(command_line));
     return map;
   }
 
@@ -67,333 +317,102 @@ public:
 private:
 
   template <concepts::Cmd>
-  friend class CmdParser;
+  friend struct CmdDescOf;
+  template <concepts::Cmd>
+  friend class ReusableParser;
 
-  std::set<std::size_t> indices_used_as_opt_values;
-  std::map<std::uint_least32_t, std::size_t> parsed_arg_idx_for_group;
+  static constexpr auto const &desc = CmdDescOf<std::remove_const_t<Cmd>>::value;
 
-  CmdParser(Cmd const &cmd, ExtraInfo const &extra_info, std::string_view const parent_cmd_name) : cmd_ref(cmd) {
-    this->extra_info.parent_cmds_names.reserve(extra_info.parent_cmds_names.size() + 1);
-    for (auto const name : extra_info.parent_cmds_names) {
-      this->extra_info.parent_cmds_names.push_back(name);
-    }
-    this->extra_info.parent_cmds_names.push_back(parent_cmd_name);
-  }
+  // parser of a subcommand of the command of `parent`
+  CmdParser(Cmd const &cmd, ParserCore const &parent) : cmd_ref(cmd), core(desc, &cmd, parent) {}
 
-  [[nodiscard]] auto get_cmd_fmt() const noexcept { return CmdFmt(this->cmd_ref.get(), this->extra_info); }
-
-  [[nodiscard]] auto get_args_map(
-    std::span<char const *> const args,
-    std::span<Token const> const tokens,
-    TokenIndices const &indices,
-    std::size_t const recursion_start_idx,
-    std::size_t recursion_end_idx
-  ) {
-    auto args_map = ArgsMap<Cmd const>();
-    args_map.exec_path = *tokens[recursion_start_idx].value;
-    if constexpr (std::tuple_size_v<decltype(this->cmd_ref.get().subcmds)> > 0) {
-      this->parse_possible_subcmd(args, args_map, tokens, indices, recursion_start_idx, recursion_end_idx);
-    }
-    // further args have to be
-    // > recursion_start_idx (because at recursion_start_idx is the subcmd)
-    // and <= recursion_end_idx
-    std::set<std::size_t> consumed_indices;
-    consumed_indices.insert(recursion_start_idx);
-    constexpr auto args_size = std::tuple_size_v<decltype(this->cmd_ref.get().args)>;
-    this->process_tokens(
-      args_map,
-      tokens,
-      indices,
-      recursion_start_idx,
-      recursion_end_idx,
-      consumed_indices,
-      std::make_index_sequence<args_size>()
-    );
-    this->check_unknown_args(args, tokens, recursion_start_idx, recursion_end_idx, consumed_indices);
-    return args_map;
+  [[nodiscard]] static ArgsMap<Cmd const> value_or_raise(result_type &&result) {
+    if (!result) result.error().raise();
+    return std::move(*result);
   }
 
-  void parse_possible_subcmd(
-    std::span<char const *> const args,
-    ArgsMap<Cmd const> &args_map,
-    std::span<Token const> const tokens,
-    TokenIndices const &indices,
-    std::size_t const recursion_start_idx,
-    std::size_t &recursion_end_idx
-  ) {
-    // Note: a command can't have positionals if it has subcommands, so it suffices to check if first positional token
-    // is a subcommand. If it's not, then the user provided an unknown subcommand, since this method is only called
-    // if the command has any subcommand. Also, the command name is not present in the indices,
-    // so 0 (or recursion_start_idx) really is the first positional.
-    auto const tok_idx = this->find_subcmd_idx(tokens, indices, recursion_start_idx);
-    if (!tok_idx.has_value()) return;
-    auto const &tok = tokens[*tok_idx];
-    if (!tok.value) return;
-    if (auto const cmd_idx = find_cmd(this->cmd_ref.get().subcmds, *tok.value); cmd_idx != -1) {
-      int i = 0;
-      // clang-format off
-      std::apply(
-        [this, &i, cmd_idx, &args_map, &args, tokens, &indices, tok_idx, recursion_end_idx](auto&&... cmd) {
-          (void)(( // cast to void to suppress unused warning
-          i == cmd_idx
-            ? (args_map.submap = CmdParser<typename std::remove_reference_t<decltype(cmd)>::type>(
-                cmd.get(), this->extra_info, this->cmd_ref.get().name).get_args_map(args, tokens, indices, *tok_idx, recursion_end_idx), true)
-            : (++i, false)
-          ) || ...);
-        },
-        this->cmd_ref.get().subcmds
-      );
-      // clang-format on
-      // when coming back from parsing a subcommand, limit the rest of the tokens to up to the token before the subcmd
-      recursion_end_idx = *tok_idx - 1;
-    } else {
-      throw UnknownSubcommand(this->cmd_ref.get().name, *tok.value, this->get_cmd_fmt());
-    }
+  [[nodiscard]] result_type parse(Scanner &scanner) {
+    auto map = ArgsMap<Cmd const>{.mem_resource = this->core.get_mem_resource()};
+    if (auto result = this->parse_into(map, scanner); !result) return std::unexpected(std::move(result.error()));
+    return map;
   }
 
-  auto find_subcmd_idx(
-    std::span<Token const> const tokens, TokenIndices const &indices, std::size_t const recursion_start_idx
-  ) const noexcept {
-    auto tok_idx = indices.first_pos_idx_after(recursion_start_idx);
-    if (!tok_idx.has_value()) return tok_idx;
-    // don't need to look further if the candidate is right after the "root" cmd name
-    if (*tok_idx == recursion_start_idx + 1) return tok_idx;
-    // otherwise, check if previous arg isn't an option (so this positional could be its value)
-    if (auto const &prev_tok = tokens[*tok_idx - 1]; prev_tok.kind == TokenKind::OPT_OR_FLG_LONG) {
-      auto const arg_idx = std::apply(
-        [&prev_tok](auto &&...arg) {
-          int idx = 0, ret = -1;
-          (void) // cast to void to suppress unused warning
-            ((arg.kind == ArgKind::OPT && arg.name == *prev_tok.name ? (ret = idx, true) : (++idx, false)) || ...);
-          return ret;
-        },
-        this->cmd_ref.get().args
-      );
-      // look for another candidate if we found a matching opt argument for the previous one
-      if (arg_idx != -1) {
-        tok_idx = indices.first_pos_idx_after(*tok_idx);
-      }
-    }
-    return tok_idx;
+  [[nodiscard]] ParseResult parse_into(ArgsMap<Cmd const> &map, Scanner &scanner) {
+    map.reset();
+    auto result = this->core.parse(&map, scanner);
+    map.mapped_files = scanner.take_response_files();
+    return result;
   }
 
-  template <std::size_t... Is>
-  void process_tokens(
-    ArgsMap<Cmd const> &args_map,
+  [[nodiscard]] result_type get_args_map(
+    std::span<std::string_view const> const args,
     std::span<Token const> const tokens,
-    TokenIndices const &indices,
-    std::size_t const recursion_start_idx,
-    std::size_t const recursion_end_idx,
-    std::set<std::size_t> &consumed_indices,
-    std::index_sequence<Is...>
+    std::size_t const recursion_start_idx
   ) {
-    try {
-      // clang-format off
-      (this->process_ith_flg_or_opt<Is>(args_map, tokens, indices, recursion_start_idx, recursion_end_idx, consumed_indices), ...);
-      // only try and process positionals if there are no subcommands
-      // because commands can't have both them and positionals
-      if constexpr (std::tuple_size_v<decltype(this->cmd_ref.get().subcmds)> == 0) {
-        std::size_t cur_pos_idx = 0;
-        (this->process_ith_pos<Is>(args_map, tokens, indices, recursion_start_idx, recursion_end_idx, consumed_indices, cur_pos_idx), ...);
-      }
-      // clang-format on
-      std::size_t cur_pos_idx = 0;
-      (this->post_process_ith_arg<Is>(args_map, tokens, indices, recursion_start_idx, cur_pos_idx), ...);
-      (this->check_missing_ith_arg<Is>(args_map), ...);
-    } catch (std::runtime_error const &e) {
-      throw UserError(e.what(), get_cmd_fmt());
-    }
+    auto args_map = ArgsMap<Cmd const>{.mem_resource = this->core.get_mem_resource()};
+    if (auto result = this->core.fill_args_map(&args_map, args, tokens, recursion_start_idx); !result)
+      return std::unexpected(std::move(result.error()));
+    return args_map;
   }
+};
 
-  template <std::size_t I>
-  void process_ith_flg_or_opt(
-    ArgsMap<Cmd const> &args_map,
-    std::span<Token const> const tokens,
-    TokenIndices const &indices,
-    std::size_t const recursion_start_idx,
-    std::size_t const recursion_end_idx,
-    std::set<std::size_t> &consumed_indices
-  ) {
-    switch (auto const &arg = std::get<I>(this->cmd_ref.get().args); arg.kind) {
-      case ArgKind::FLG: {
-        std::size_t flg_count = 0;
-        if (auto const it = indices.opts_n_flgs.find(arg.name); it != indices.opts_n_flgs.end()) {
-          for (auto const idx : it->second) {
-            if (idx > recursion_start_idx && idx <= recursion_end_idx) {
-              flg_count += 1;
-              consumed_indices.insert(idx);
-            }
-          }
-        }
-        if (auto const it = indices.opts_n_flgs.find(arg.abbrev); it != indices.opts_n_flgs.end()) {
-          for (auto const idx : it->second) {
-            if (idx > recursion_start_idx && idx <= recursion_end_idx) {
-              flg_count += 1;
-              consumed_indices.insert(idx);
-            }
-          }
-        }
-
-        if (flg_count > 0) consume_arg<I>(args_map, arg, flg_count, this->cmd_ref.get(), this->extra_info);
-        break;
-      }
-      case ArgKind::OPT: {
-        auto const it_name = indices.opts_n_flgs.find(arg.name);
-        auto const has_name = it_name != indices.opts_n_flgs.end();
-        auto const it_abbrev = indices.opts_n_flgs.find(arg.abbrev);
-        auto const has_abbrev = it_abbrev != indices.opts_n_flgs.end();
-        if (!has_name && !has_abbrev) return;
-
-        auto const reserve_size = (has_name ? it_name->second.size() : 0) + (has_abbrev ? it_abbrev->second.size() : 0);
-        std::vector<std::string_view> opt_values; // TODO: make it vector of optionals to support implicit value
-        std::vector<std::size_t> all_idxs;
-        if (reserve_size > 0) {
-          opt_values.reserve(reserve_size);
-          all_idxs.reserve(reserve_size);
-        }
-        if (has_name) {
-          for (auto const idx : it_name->second) {
-            if (idx > recursion_start_idx && idx <= recursion_end_idx) {
-              all_idxs.push_back(idx);
-              consumed_indices.insert(idx);
-            }
-          }
-        }
-        if (has_abbrev) {
-          for (auto const idx : it_abbrev->second) {
-            if (idx > recursion_start_idx && idx <= recursion_end_idx) {
-              all_idxs.push_back(idx);
-              consumed_indices.insert(idx);
-            }
-          }
-        }
-        std::ranges::sort(all_idxs);
-
-        for (auto const idx : all_idxs) {
-          if (tokens[idx].value) opt_values.push_back(*tokens[idx].value);
-          // the case of `--option value` or `-O value` may have the value as "the next positional"
-          // see note in the other process_ith_arg member function
-          else if (idx + 1 < tokens.size() && tokens[idx + 1].kind == TokenKind::IDENTIFIER) {
-            opt_values.push_back(*tokens[idx + 1].value);
-            this->indices_used_as_opt_values.insert(idx + 1);
-            consumed_indices.insert(idx + 1);
-          }
-        }
-
-        if (!opt_values.empty())
-          consume_arg<I>(args_map, arg, std::cref(opt_values), this->cmd_ref.get(), this->extra_info);
-        else throw MissingValue(has_name ? arg.name : arg.abbrev, 1, 0);
-        break;
-      }
-      // ignore positionals in this call
-      case ArgKind::POS: [[fallthrough]];
-      default: break;
-    }
-  }
+// +-----------------------+
+// |    ReusableParser     |
+// +-----------------------+
 
-  template <std::size_t I>
-  void process_ith_pos(
-    ArgsMap<Cmd const> &args_map,
-    std::span<Token const> const tokens,
-    TokenIndices const &indices,
-    std::size_t const recursion_start_idx,
-    std::size_t const recursion_end_idx,
-    std::set<std::size_t> &consumed_indices,
-    std::size_t &cur_pos_idx // can't use this as static variable because this is a function *template*
-  ) {
-    auto const &arg = std::get<I>(this->cmd_ref.get().args);
-    if (arg.kind != ArgKind::POS) return;
-    if (cur_pos_idx >= indices.positionals.size()) return;
-    /* Note: things like `-O value` are scanned as an option followed by an identifier, since the scanner doesn't know
-     * if -O is valid or not. So when we encounter that in the process_ith_arg, and it indeed was an option, we save the
-     * token index in this->indices_used_as_opt_values to be ignored here. When we hit such a case, we need to loop
-     * until we find the next index that is just an identifier (not one that follows a short valueless option).
-     **/
-    auto tok_idx = indices.positionals[cur_pos_idx];
-    while (this->indices_used_as_opt_values.contains(tok_idx) || tok_idx <= recursion_start_idx) {
-      if (cur_pos_idx + 1 >= indices.positionals.size() || tok_idx > recursion_end_idx) return;
-      tok_idx = indices.positionals[++cur_pos_idx];
-    }
-    if (tok_idx >= tokens.size()) return;
+// Parses command lines of the same command over and over, e.g. in a long-lived service. The arguments and tokens of the
+// previous parse are kept for the next one, and everything else (indices, values in the map, etc) gives its memory back
+// to a pool that the next parse takes it from, so that once warmed up parsing doesn't allocate from `upstream`.
+// Not thread-safe. Maps that it parses into point into its memory and must not outlive it.
+template <concepts::Cmd Cmd>
+class ReusableParser {
+public:
+
+  explicit ReusableParser(Cmd const &cmd, std::pmr::memory_resource *const upstream = std::pmr::get_default_resource())
+    : pool(pool_options, upstream), parser(cmd, &this->pool), scanner(&this->pool), command_line(&this->pool) {}
+
+  // `parser` and `scanner` point to `pool`
+  ReusableParser(ReusableParser const &) = delete;
+  ReusableParser &operator=(ReusableParser const &) = delete;
 
-    cur_pos_idx += 1;
-    consumed_indices.insert(tok_idx);
-    if (auto const &tok = tokens[tok_idx]; tok.value)
-      consume_arg<I>(args_map, arg, *tok.value, this->cmd_ref.get(), this->extra_info);
+  // A map whose values take their memory from this parser
+  [[nodiscard]] ArgsMap<Cmd const> new_map() { return ArgsMap<Cmd const>{.mem_resource = &this->pool}; }
+
+  // Parses `args` into `map`, replacing what it had. Errors are thrown as `UserError` rather than handled by the
+  // command's error handler, which is left to the caller.
+  void parse_into(ArgsMap<Cmd const> &map, std::span<char const *> const args) {
+    if (auto result = this->try_parse_into(map, args); !result) result.error().raise();
   }
 
-  template <std::size_t I>
-  void post_process_ith_arg(
-    ArgsMap<Cmd const> &args_map,
-    std::span<Token const> const tokens,
-    TokenIndices const &indices,
-    std::size_t const recursion_start_idx,
-    std::size_t &cur_pos_idx // can't use this as static variable because this is a function *template*
-  ) {
-    auto const &arg = std::get<I>(this->cmd_ref.get().args);
-    if (args_map.template has_value<I>()) {
-      // get index of arg in argv (we know it exists because it's present in args_map)
-      auto const arg_idx = [&arg, &indices, recursion_start_idx, cur_pos_idx] {
-        if (arg.kind == ArgKind::POS) return *indices.nth_pos_idx_after(recursion_start_idx, cur_pos_idx);
-        if (auto const it_name = indices.opts_n_flgs.find(arg.name); it_name != indices.opts_n_flgs.end())
-          return it_name->second[0];
-        auto const it_abbrev = indices.opts_n_flgs.find(arg.abbrev);
-        return it_abbrev->second[0];
-      }();
-
-      // check if we already have parsed an argument of the same group
-      if (arg.grp_kind == GroupKind::MUTUALLY_EXCLUSIVE) {
-        if (auto const grp_it = this->parsed_arg_idx_for_group.find(arg.grp_id);
-            grp_it != this->parsed_arg_idx_for_group.end()) {
-          auto const tok_current =
-            std::find_if(tokens.begin(), tokens.end(), [arg_idx](auto const &t) { return t.args_idx == arg_idx; });
-          auto const tok_previous = std::find_if(tokens.begin(), tokens.end(), [&grp_it](auto const &t) {
-            return t.args_idx == grp_it->second;
-          });
-          throw ConflictingArguments(
-            this->cmd_ref.get().name, tok_current->get_id(), tok_previous->get_id(), this->get_cmd_fmt()
-          );
-        }
-      }
-
-      // if not, register we now have
-      if (arg.has_group()) {
-        this->parsed_arg_idx_for_group[arg.grp_id] = arg_idx;
-      }
-    }
-    cur_pos_idx += static_cast<std::size_t>(arg.kind == ArgKind::POS);
+  void parse_into(ArgsMap<Cmd const> &map, int const argc, char const *argv[]) {
+    this->parse_into(map, std::span{argv, static_cast<std::size_t>(argc)});
   }
 
-  template <std::size_t I>
-  void check_missing_ith_arg(ArgsMap<Cmd const> &args_map) const {
-    auto const &arg = std::get<I>(this->cmd_ref.get().args);
-    if (!args_map.template has_value<I>()) {
-      if (arg.is_required && !arg.has_group())
-        throw MissingRequiredArgument(this->cmd_ref.get().name, arg.name, get_cmd_fmt());
-      if (arg.grp_kind == GroupKind::ALL_REQUIRED && this->parsed_arg_idx_for_group.contains(arg.grp_id))
-        throw MissingAllRequiredGroupedArguments(this->cmd_ref.get().name, arg.name, get_cmd_fmt());
-      if (arg.grp_kind == GroupKind::MUTUALLY_EXCLUSIVE && !this->parsed_arg_idx_for_group.contains(arg.grp_id))
-        throw MissingMutuallyExclusiveGroupedArguments(this->cmd_ref.get().name, arg.name, get_cmd_fmt());
-      if (arg.has_default()) std::get<I>(args_map.args) = *arg.default_value;
-    }
+  // Parses a command string (see `CommandLine`) into `map`. Values may point into `line`, which must outlive them.
+  void parse_into(ArgsMap<Cmd const> &map, std::string_view const line) {
+    if (auto result = this->try_parse_into(map, line); !result) result.error().raise();
   }
 
-  void check_unknown_args(
-    std::span<char const *> const args,
-    std::span<Token const> const tokens,
-    std::size_t const recursion_start_idx,
-    std::size_t const recursion_end_idx,
-    std::set<std::size_t> const &consumed_indices
-  ) const {
-    if (std::size_t const recursion_amount_indices = recursion_end_idx - recursion_start_idx + 1;
-        consumed_indices.size() < recursion_amount_indices) {
-      std::vector<std::string_view> unknown_args;
-      for (std::size_t idx = recursion_start_idx; idx <= recursion_end_idx; ++idx) {
-        if (!consumed_indices.contains(idx)) unknown_args.emplace_back(args[tokens[idx].args_idx]);
-      }
-      throw UnknownArguments(this->cmd_ref.get().name, unknown_args, this->get_cmd_fmt());
-    }
+  // Like `parse_into`, but errors and asking for help or the version are returned instead (see `Cmd::try_parse`)
+  [[nodiscard]] ParseResult try_parse_into(ArgsMap<Cmd const> &map, std::span<char const *> const args) {
+    if (auto result = this->parser.core.rescan(this->scanner, args); !result) return result;
+    return this->parser.parse_into(map, this->scanner);
+  }
+
+  [[nodiscard]] ParseResult try_parse_into(ArgsMap<Cmd const> &map, std::string_view const line) {
+    if (auto result = this->parser.core.rescan(this->scanner, this->command_line, line); !result) return result;
+    return this->parser.parse_into(map, this->scanner);
   }
+
+private:
+
+  // blocks of up to 64KiB are pooled, which covers the buffers of command lines with thousands of arguments
+  static constexpr std::pmr::pool_options pool_options{.largest_required_pool_block = 64 * 1024};
+
+  std::pmr::unsynchronized_pool_resource pool;
+  CmdParser<Cmd> parser;
+  Scanner scanner;
+  CommandLine command_line;
 };
 
 } // namespace opz
@@ -0,0 +1,55 @@
+#ifndef OPZIONI_RESPONSE_FILE_HPP
+#define OPZIONI_RESPONSE_FILE_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace opz {
+
+struct ResponseFileConfig {
+  // split the file on NUL characters (e.g. from `find -print0`) instead of whitespace and quotes
+  bool nul_separated{false};
+  // how many response files may be nested in one another, counting the outermost one
+  std::size_t max_depth{8};
+};
+
+// +--------------------------------+
+// |           MappedFile           |
+// +--------------------------------+
+
+// Read-only memory mapping of a whole file, which stays valid (and at the same address) until destroyed
+class MappedFile {
+public:
+
+  explicit MappedFile(char const *path);
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+  ~MappedFile();
+
+  [[nodiscard]] std::string_view contents() const noexcept;
+
+private:
+
+  void *data{nullptr};
+  std::size_t size{0};
+};
+
+// Appends the arguments in the response file at `path` to `args`, as views into its mapping (which is appended to
+// `files`), and recursively expands the response files that it refers to. Arguments are separated by whitespace and
+// may be quoted with either ' or " to contain whitespace, but there are no escapes since arguments are not copied.
+void expand_response_file(
+  std::string_view path,
+  ResponseFileConfig const &config,
+  std::pmr::vector<std::string_view> &args,
+  std::pmr::vector<MappedFile> &files,
+  std::size_t depth = 1
+);
+
+} // namespace opz
+
+#endif // OPZIONI_RESPONSE_FILE_HPP
@@ -2,12 +2,16 @@
 #define OPZIONI_SCANNER_HPP
 
 #include <cstdint>
-#include <map>
+#include <memory_resource>
 #include <optional>
 #include <span>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include "opzioni/response_file.hpp"
+#include "opzioni/schema.hpp"
+
 namespace opz {
 
 constexpr static auto dash = '-';
@@ -16,10 +20,11 @@ enum struct TokenKind {
   PROG_NAME,
   DASH_DASH,           // --
   FLG,                 // -f (-xpto adds many of this)
-  OPT_OR_FLG_LONG,     // --option or --flag
+  OPT_OR_FLG_LONG,     // --option or --flag (or --option value, if it is known to be an option)
   OPT_LONG_AND_VALUE,  // --option=value
-  OPT_SHORT_AND_VALUE, // -Ovalue
-  IDENTIFIER,          // positional, command, value after OPT_OR_FLG_LONG
+  OPT_SHORT_AND_VALUE, // -Ovalue or -O value
+  IDENTIFIER,          // positional
+  SUBCMD,              // name of a subcommand of the command being scanned
 };
 
 struct Token {
@@ -27,79 +32,134 @@ struct Token {
   std::uint32_t args_idx;
   std::optional<std::string_view> name;
   std::optional<std::string_view> value;
+  // index of the argument (or of the subcommand, for SUBCMD) in the command that this token belongs to; -1 if unknown
+  int slot{-1};
 
   [[nodiscard]] std::string_view get_id() const noexcept {
-    if (this->kind == TokenKind::IDENTIFIER) return *this->value;
+    if (this->kind == TokenKind::IDENTIFIER || this->kind == TokenKind::SUBCMD) return *this->value;
     return *this->name;
   }
 };
 
-struct TokenIndices {
-  std::vector<std::size_t> positionals;
-  std::map<std::string_view, std::vector<std::size_t>> opts_n_flgs;
-
-  [[nodiscard]] std::optional<std::size_t>
-  nth_pos_idx_after(std::size_t const offset, std::size_t const n) const noexcept {
-    if (this->positionals.empty()) return std::nullopt;
-    std::size_t i = 0;
-    auto idx = this->positionals[i];
-    while (idx <= offset) {
-      if (i + 1 >= this->positionals.size()) return std::nullopt;
-      idx = this->positionals[++i];
-    }
-    std::size_t count = 0;
-    while (count < n) {
-      if (i + 1 >= this->positionals.size()) return std::nullopt;
-      idx = this->positionals[++i];
-      count += 1;
-    }
-    return idx;
+// Occurrences of each argument of a single command, in compressed sparse row layout: the token indices of argument `i`
+// are `occurrences[offsets[i]..offsets[i + 1])`, with positionals stored as one extra argument after all the others.
+// Offsets and occurrences share the same allocation, which is made once regardless of how many arguments there are.
+class TokenIndices {
+public:
+
+  TokenIndices() = default;
+  TokenIndices(
+    std::size_t const args_count,
+    std::size_t const max_occurrences,
+    std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  )
+    : args_count(args_count), storage(args_count + 2 + max_occurrences, 0, mem_resource) {}
+
+  [[nodiscard]] std::span<std::size_t const> occurrences_of(std::size_t const arg_idx) const noexcept {
+    auto const first = this->storage[arg_idx], last = this->storage[arg_idx + 1];
+    return std::span(this->storage).subspan(this->args_count + 2 + first, last - first);
   }
 
-  [[nodiscard]] std::optional<std::size_t> first_pos_idx_after(std::size_t const offset) const noexcept {
-    return this->nth_pos_idx_after(offset, 0);
+  [[nodiscard]] std::span<std::size_t const> positionals() const noexcept {
+    return this->occurrences_of(this->args_count);
   }
+
+  [[nodiscard]] std::optional<std::size_t> nth_pos_idx(std::size_t const n) const noexcept {
+    auto const pos = this->positionals();
+    if (n >= pos.size()) return std::nullopt;
+    return pos[n];
+  }
+
+private:
+
+  friend TokenIndices
+  index_tokens(std::span<Token const>, std::size_t, std::size_t, std::size_t, std::pmr::memory_resource *);
+
+  std::size_t args_count{0};
+  std::pmr::vector<std::size_t> storage; // `args_count + 2` offsets, then the occurrences themselves
 };
 
 std::string_view to_string(TokenKind kind) noexcept;
-TokenIndices index_tokens(std::span<Token const> tokens);
-
+TokenIndices index_tokens(
+  std::span<Token const> tokens,
+  std::size_t args_count,
+  std::size_t first,
+  std::size_t last,
+  std::pmr::memory_resource *mem_resource = std::pmr::get_default_resource()
+);
+
+// Tokenizes the command line following the schema of the commands being parsed, so that it is known right away which
+// arguments are values of options and which identifiers are subcommands, without looking back at previous tokens
 class Scanner {
 public:
 
-  explicit Scanner(std::span<char const *> const args) {
-    this->tokens.reserve(args.size());
-    this->args.reserve(args.size());
-    for (char const *a : args) {
-      this->args.emplace_back(a);
-    }
-  }
-
-  Scanner(int const argc, char const *argv[]) : Scanner(std::span{argv, static_cast<std::size_t>(argc)}) {}
-
-  std::vector<Token> operator()() noexcept;
+  // A scanner without arguments, to be given some with `reset()`
+  explicit Scanner(std::pmr::memory_resource *mem_resource = std::pmr::get_default_resource()) noexcept;
+
+  // `@path` arguments are replaced by the arguments in the file at `path` if `response_files` is set, in which case
+  // the scanned arguments are only valid for as long as the scanner or its `take_response_files()` are alive
+  Scanner(
+    std::span<char const *> args,
+    CmdRef root,
+    std::optional<ResponseFileConfig> const &response_files = std::nullopt,
+    std::pmr::memory_resource *mem_resource = std::pmr::get_default_resource()
+  );
+
+  Scanner(
+    int const argc,
+    char const *argv[],
+    CmdRef const root,
+    std::optional<ResponseFileConfig> const &response_files = std::nullopt,
+    std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  )
+    : Scanner(std::span{argv, static_cast<std::size_t>(argc)}, root, response_files, mem_resource) {}
+
+  // Starts over with `args` (see the constructor), keeping the memory of the arguments and tokens scanned so far
+  void reset(
+    std::span<char const *> args,
+    CmdRef root,
+    std::optional<ResponseFileConfig> const &response_files = std::nullopt
+  );
+
+  // Scans one more argument, for arguments that arrive incrementally. An argument is only scanned once the next one is
+  // available (since it might be the value of an option), so the last one waits until `operator()`.
+  void push(std::string_view arg) noexcept;
+
+  // Scans whatever arguments are left. The tokens are valid until the scanner is reset or destroyed.
+  std::span<Token const> operator()() noexcept;
+
+  // arguments after expanding response files, which `Token::args_idx` refers to
+  [[nodiscard]] std::span<std::string_view const> get_args() const noexcept { return this->args; }
+  [[nodiscard]] std::pmr::vector<MappedFile> take_response_files() noexcept { return std::move(this->response_files); }
 
 private:
 
-  std::vector<std::string_view> args;
+  std::pmr::vector<std::string_view> args;
+  std::pmr::vector<MappedFile> response_files;
 
-  std::vector<Token> tokens;
+  std::pmr::vector<Token> tokens;
+  CmdRef cur_cmd;
   std::uint32_t args_idx = 0;
   std::uint32_t cur_col = 0;
+  bool after_dash_dash = false;
 
   [[nodiscard]] inline std::string_view const &cur_arg() const noexcept;
   [[nodiscard]] bool is_cur_end() const noexcept;
   [[nodiscard]] auto advance() noexcept;
   [[nodiscard]] char peek() const noexcept;
   void consume() noexcept;
-  [[nodiscard]] bool match(char expected) noexcept;
+  [[nodiscard]] std::optional<std::string_view> peek_next_value() const noexcept;
 
   void add_token(
     TokenKind kind,
     std::optional<std::string_view> name = std::nullopt,
-    std::optional<std::string_view> value = std::nullopt
+    std::optional<std::string_view> value = std::nullopt,
+    int slot = -1
   ) noexcept;
+  void add_opt_token(TokenKind kind, std::string_view name, int slot) noexcept;
+  void scan_pending(bool is_final) noexcept;
   void scan_token() noexcept;
+  void identifier() noexcept;
   void long_opt() noexcept;
   void short_opt() noexcept;
 };
@@ -0,0 +1,36 @@
+#ifndef OPZIONI_SCHEMA_HPP
+#define OPZIONI_SCHEMA_HPP
+
+#include <span>
+#include <string_view>
+
+#include "opzioni/arg.hpp"
+#include "opzioni/lookup.hpp"
+
+namespace opz {
+
+struct CmdSchema;
+
+// Type-erased reference to a command object together with the schema of its type
+struct CmdRef {
+  void const *cmd{nullptr};
+  CmdSchema const *schema{nullptr};
+};
+
+// What the scanner needs to know about a command (and that isn't available from the command line alone) in order to
+// tokenize its arguments in a single pass: which names are options that take a value, and which are subcommands
+struct CmdSchema {
+  ArgLookupView lookup;
+  std::span<ArgKind const> kinds;
+  // index of the subcommand of `cmd` with the given name, or -1
+  int (*find_subcmd)(void const *cmd, std::string_view name) noexcept;
+  CmdRef (*get_subcmd)(void const *cmd, int idx) noexcept;
+
+  [[nodiscard]] constexpr bool takes_value(int const arg_idx) const noexcept {
+    return arg_idx != -1 && this->kinds[arg_idx] == ArgKind::OPT;
+  }
+};
+
+} // namespace opz
+
+#endif // OPZIONI_SCHEMA_HPP
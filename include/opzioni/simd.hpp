@@ -0,0 +1,67 @@
+#ifndef OPZIONI_SIMD_HPP
+#define OPZIONI_SIMD_HPP
+
+#include <bit>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace opz {
+
+#if defined(__SSE2__)
+constexpr std::size_t simd_width = 16;
+
+// Bit `i` is set if byte `i` of the 16 at `data` is one of `Chars`
+template <char... Chars>
+[[nodiscard]] inline unsigned match_mask(char const *const data) noexcept {
+  auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data));
+  auto matches = _mm_setzero_si128();
+  ((matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, _mm_set1_epi8(Chars)))), ...);
+  return static_cast<unsigned>(_mm_movemask_epi8(matches));
+}
+#endif
+
+// Index of the first byte of `str` at or after `idx` that is one of `Chars`, or `str.size()`. With SSE2, 16 bytes are
+// compared against all of `Chars` at once.
+template <char... Chars>
+[[nodiscard]] inline std::size_t find_any(std::string_view const str, std::size_t idx) noexcept {
+#if defined(__SSE2__)
+  for (; idx + simd_width <= str.size(); idx += simd_width) {
+    if (auto const mask = match_mask<Chars...>(str.data() + idx); mask != 0)
+      return idx + static_cast<std::size_t>(std::countr_zero(mask));
+  }
+#endif
+  for (; idx < str.size(); ++idx) {
+    if (((str[idx] == Chars) || ...)) return idx;
+  }
+  return str.size();
+}
+
+// Amount of bytes of `str` that are `Char`, without branching on any of them
+template <char Char>
+[[nodiscard]] inline std::size_t count_of(std::string_view const str) noexcept {
+  std::size_t amount = 0, idx = 0;
+#if defined(__SSE2__)
+  while (idx + simd_width <= str.size()) {
+    // a counter per byte position, which can't overflow in fewer than 256 blocks, then summed up all at once
+    auto counters = _mm_setzero_si128();
+    for (int blocks = 0; blocks < 255 && idx + simd_width <= str.size(); ++blocks, idx += simd_width) {
+      auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str.data() + idx));
+      counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, _mm_set1_epi8(Char)));
+    }
+    auto const sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+    amount += static_cast<std::size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+  }
+#endif
+  for (; idx < str.size(); ++idx) {
+    amount += static_cast<std::size_t>(str[idx] == Char);
+  }
+  return amount;
+}
+
+} // namespace opz
+
+#endif // OPZIONI_SIMD_HPP
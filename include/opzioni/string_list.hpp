@@ -1,7 +1,12 @@
 #ifndef OPZIONI_STRING_LIST_HPP
 #define OPZIONI_STRING_LIST_HPP
 
+#include <array>
+#include <string_view>
+#include <type_traits>
+
 #include "opzioni/fixed_string.hpp"
+#include "opzioni/type_list.hpp"
 
 namespace opz {
 
@@ -18,26 +23,35 @@ template <FixedString, typename...>
 struct InStringList : std::false_type {};
 
 template <FixedString Needle, FixedString... Haystack>
-struct InStringList<Needle, StringList<Needle, Haystack...>> : std::true_type {};
-
-template <FixedString Needle, FixedString Other, FixedString... Haystack>
-struct InStringList<Needle, StringList<Other, Haystack...>> : InStringList<Needle, StringList<Haystack...>> {};
+struct InStringList<Needle, StringList<Haystack...>>
+  : std::bool_constant<((std::string_view(Needle) == std::string_view(Haystack)) || ...)> {};
 
 // +--------------------------------+
 // |           IndexOfStr           |
 // +--------------------------------+
 
-// base case (str not found)
+// str not found
 template <int Idx, FixedString, typename...>
 struct IndexOfStr : std::integral_constant<int, -1> {};
 
-// base case (str found)
 template <int Idx, FixedString Needle, FixedString... Haystack>
-struct IndexOfStr<Idx, Needle, StringList<Needle, Haystack...>> : std::integral_constant<int, Idx> {};
+struct IndexOfStr<Idx, Needle, StringList<Haystack...>>
+  : std::integral_constant<
+      int,
+      index_of_first(
+        std::array<bool, sizeof...(Haystack)>{(std::string_view(Needle) == std::string_view(Haystack))...}, Idx
+      )> {};
+
+// +--------------------------------+
+// |         StringArrayOf          |
+// +--------------------------------+
+
+template <typename...>
+struct StringArrayOf;
 
-// recursive case (keep looking)
-template <int Idx, FixedString Needle, FixedString Other, FixedString... Haystack>
-struct IndexOfStr<Idx, Needle, StringList<Other, Haystack...>> : IndexOfStr<Idx + 1, Needle, StringList<Haystack...>> {
+template <FixedString... Strs>
+struct StringArrayOf<StringList<Strs...>> {
+  static constexpr std::array<std::string_view, sizeof...(Strs)> value{std::string_view(Strs)...};
 };
 
 } // namespace opz
@@ -0,0 +1,100 @@
+#ifndef OPZIONI_TOKEN_BITSET_HPP
+#define OPZIONI_TOKEN_BITSET_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace opz {
+
+// Set of token indices in [first, first + size), as a dense bitmap. Command lines of up to `inline_bits` tokens (which
+// is most of them) don't allocate; longer ones make a single allocation for the whole span from the given resource.
+class TokenBitset {
+public:
+
+  static constexpr std::size_t word_bits = 64;
+  static constexpr std::size_t inline_bits = 256;
+
+  TokenBitset(
+    std::size_t const first,
+    std::size_t const size,
+    std::pmr::memory_resource *const mem_resource = std::pmr::get_default_resource()
+  )
+    : first(first), size(size), allocator(mem_resource), words(inline_words.data()) {
+    if (auto const amount_words = this->amount_words(); amount_words > inline_words.size()) {
+      this->words = this->allocator.allocate(amount_words);
+      std::fill_n(this->words, amount_words, std::uint64_t{0});
+    }
+  }
+
+  ~TokenBitset() {
+    if (this->words != this->inline_words.data()) this->allocator.deallocate(this->words, this->amount_words());
+  }
+
+  // `words` may point into the object itself
+  TokenBitset(TokenBitset const &) = delete;
+  TokenBitset &operator=(TokenBitset const &) = delete;
+
+  void insert(std::size_t const idx) noexcept {
+    auto const bit = idx - this->first;
+    this->words[bit / word_bits] |= std::uint64_t{1} << (bit % word_bits);
+  }
+
+  template <typename It>
+  void insert(It begin, It const end) noexcept {
+    for (; begin != end; ++begin) {
+      this->insert(*begin);
+    }
+  }
+
+  [[nodiscard]] bool covers(std::size_t const idx) const noexcept {
+    return idx >= this->first && idx - this->first < this->size;
+  }
+
+  [[nodiscard]] bool contains(std::size_t const idx) const noexcept {
+    auto const bit = idx - this->first;
+    return (this->words[bit / word_bits] >> (bit % word_bits)) & 1;
+  }
+
+  // Calls `f` with every index in the span that is not in the set, in increasing order, skipping whole words at a time
+  template <typename F>
+  void for_each_missing(F &&f) const {
+    for (std::size_t w = 0; w < this->amount_words(); ++w) {
+      auto missing = ~this->words[w] & this->mask_of(w);
+      while (missing != 0) {
+        f(this->first + w * word_bits + static_cast<std::size_t>(std::countr_zero(missing)));
+        missing &= missing - 1;
+      }
+    }
+  }
+
+  [[nodiscard]] bool all() const noexcept {
+    for (std::size_t w = 0; w < this->amount_words(); ++w) {
+      if (this->words[w] != this->mask_of(w)) return false;
+    }
+    return true;
+  }
+
+private:
+
+  std::size_t first;
+  std::size_t size;
+  std::array<std::uint64_t, inline_bits / word_bits> inline_words{};
+  std::pmr::polymorphic_allocator<std::uint64_t> allocator;
+  std::uint64_t *words;
+
+  [[nodiscard]] std::size_t amount_words() const noexcept { return (this->size + word_bits - 1) / word_bits; }
+
+  // bits of word `w` that are within the span (all of them, except maybe for the last word)
+  [[nodiscard]] std::uint64_t mask_of(std::size_t const w) const noexcept {
+    auto const bits_left = this->size - w * word_bits;
+    return bits_left < word_bits ? (std::uint64_t{1} << bits_left) - 1 : ~std::uint64_t{0};
+  }
+};
+
+} // namespace opz
+
+#endif // OPZIONI_TOKEN_BITSET_HPP
@@ -1,10 +1,25 @@
 #ifndef OPZIONI_TYPE_LIST_HPP
 #define OPZIONI_TYPE_LIST_HPP
 
+#include <array>
+#include <cstddef>
+#include <tuple>
 #include <type_traits>
 
 namespace opz {
 
+// The lookups below are a single fold or array search over the whole pack instead of a recursion over its elements,
+// so that they instantiate a constant number of templates no matter how long the list is
+
+// Index of the first `true` in `matches`, offset by `offset`, or -1 if there is none
+template <std::size_t N>
+[[nodiscard]] consteval int index_of_first(std::array<bool, N> const &matches, int const offset) noexcept {
+  for (std::size_t i = 0; i < N; ++i) {
+    if (matches[i]) return offset + static_cast<int>(i);
+  }
+  return -1;
+}
+
 template <typename...>
 struct TypeList;
 
@@ -16,10 +31,8 @@ template <int, typename...>
 struct IndexOfType : std::integral_constant<int, -1> {};
 
 template <int Idx, typename T, typename... Ts>
-struct IndexOfType<Idx, T, TypeList<T, Ts...>> : std::integral_constant<int, Idx> {};
-
-template <int Idx, typename T, typename U, typename... Ts>
-struct IndexOfType<Idx, T, TypeList<U, Ts...>> : IndexOfType<Idx + 1, T, TypeList<Ts...>> {};
+struct IndexOfType<Idx, T, TypeList<Ts...>>
+  : std::integral_constant<int, index_of_first(std::array<bool, sizeof...(Ts)>{std::is_same_v<T, Ts>...}, Idx)> {};
 
 // +----------------------------------+
 // |              InList              |
@@ -29,10 +42,24 @@ template <typename...>
 struct InList : std::false_type {};
 
 template <typename T, typename... Ts>
-struct InList<T, TypeList<T, Ts...>> : std::true_type {};
+struct InList<T, TypeList<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)> {};
+
+// +----------------------------------+
+// |              TypeAt              |
+// +----------------------------------+
 
-template <typename T, typename U, typename... Ts>
-struct InList<T, TypeList<U, Ts...>> : InList<T, TypeList<Ts...>> {};
+// `Idx`th type of the list, or `void` if `Idx` is out of bounds (e.g. the -1 of a failed lookup)
+template <int, typename...>
+struct TypeAt {
+  using type = void;
+};
+
+template <int Idx, typename... Ts>
+  requires(Idx >= 0 && Idx < static_cast<int>(sizeof...(Ts)))
+struct TypeAt<Idx, TypeList<Ts...>> {
+  // std::tuple_element is implemented with a compiler builtin that does not recurse over the pack
+  using type = std::tuple_element_t<static_cast<std::size_t>(Idx), std::tuple<Ts...>>;
+};
 
 // +----------------------------------+
 // |              Concat              |
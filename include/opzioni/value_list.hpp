@@ -1,8 +1,11 @@
 #ifndef OPZIONI_VALUE_LIST_HPP
 #define OPZIONI_VALUE_LIST_HPP
 
+#include <array>
 #include <type_traits>
 
+#include "opzioni/type_list.hpp"
+
 namespace opz {
 
 template <typename T, T...>
@@ -16,27 +19,32 @@ template <typename T, T, typename...>
 struct InValueList : std::false_type {};
 
 template <typename T, T Needle, T... Haystack>
-struct InValueList<T, Needle, ValueList<T, Needle, Haystack...>> : std::true_type {};
-
-template <typename T, T Needle, T Other, T... Haystack>
-struct InValueList<T, Needle, ValueList<T, Other, Haystack...>> : InValueList<T, Needle, ValueList<T, Haystack...>> {};
+struct InValueList<T, Needle, ValueList<T, Haystack...>> : std::bool_constant<((Needle == Haystack) || ...)> {};
 
 // +----------------------------------+
 // |           IndexOfValue           |
 // +----------------------------------+
 
-// base case (value not found)
+// value not found
 template <int, typename T, T, typename...>
 struct IndexOfValue : std::integral_constant<int, -1> {};
 
-// base case (value found)
 template <int Idx, typename T, T Needle, T... Haystack>
-struct IndexOfValue<Idx, T, Needle, ValueList<T, Needle, Haystack...>> : std::integral_constant<int, Idx> {};
+struct IndexOfValue<Idx, T, Needle, ValueList<T, Haystack...>>
+  : std::integral_constant<int, index_of_first(std::array<bool, sizeof...(Haystack)>{(Needle == Haystack)...}, Idx)> {
+};
+
+// +----------------------------------+
+// |             ArrayOf              |
+// +----------------------------------+
+
+template <typename...>
+struct ArrayOf;
 
-// recursive case (keep looking)
-template <int Idx, typename T, T Needle, T Other, T... Haystack>
-struct IndexOfValue<Idx, T, Needle, ValueList<T, Other, Haystack...>>
-  : IndexOfValue<Idx + 1, T, Needle, ValueList<T, Haystack...>> {};
+template <typename T, T... Values>
+struct ArrayOf<ValueList<T, Values...>> {
+  static constexpr std::array<T, sizeof...(Values)> value{Values...};
+};
 
 } // namespace opz
 
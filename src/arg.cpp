@@ -11,4 +11,14 @@ std::string_view to_string(ArgKind const at) noexcept {
   }
 }
 
+std::string_view to_string(ArgOrigin const origin) noexcept {
+  switch (origin) {
+    case ArgOrigin::CMD_LINE: return "command line";
+    case ArgOrigin::ENV: return "environment";
+    case ArgOrigin::CONFIG_FILE: return "config file";
+    case ArgOrigin::DEFAULT: return "default";
+    default: return "unknown";
+  }
+}
+
 } // namespace opz
@@ -0,0 +1,111 @@
+#include "opzioni/arg_stream.hpp"
+#include "opzioni/exceptions.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <unistd.h>
+
+namespace opz {
+
+ArgStream::ArgStream(
+  int const fd, char const delimiter, std::size_t const chunk_size, std::pmr::memory_resource *const mem_resource
+)
+  : fd(fd),
+    delimiter(delimiter),
+    chunk_size(std::max(chunk_size, std::size_t{1})),
+    mem_resource(mem_resource),
+    chunks(mem_resource) {}
+
+ArgStream::ArgStream(ArgStream &&other) noexcept
+  : fd(other.fd),
+    delimiter(other.delimiter),
+    chunk_size(other.chunk_size),
+    mem_resource(other.mem_resource),
+    chunks(std::move(other.chunks)),
+    begin(other.begin),
+    searched(other.searched),
+    end(other.end),
+    eof(other.eof) {
+  other.chunks.clear(); // so that they aren't deallocated twice
+}
+
+ArgStream &ArgStream::operator=(ArgStream &&other) noexcept {
+  if (this != &other) {
+    this->release();
+    this->fd = other.fd;
+    this->delimiter = other.delimiter;
+    this->chunk_size = other.chunk_size;
+    this->mem_resource = other.mem_resource;
+    this->chunks = std::move(other.chunks);
+    this->begin = other.begin;
+    this->searched = other.searched;
+    this->end = other.end;
+    this->eof = other.eof;
+    other.chunks.clear(); // so that they aren't deallocated twice
+  }
+  return *this;
+}
+
+ArgStream::~ArgStream() { this->release(); }
+
+std::optional<std::string_view> ArgStream::next() {
+  while (true) {
+    if (!this->chunks.empty()) {
+      auto const *const data = this->chunks.back().data;
+      auto const *const found = std::find(data + this->searched, data + this->end, this->delimiter);
+      this->searched = static_cast<std::size_t>(found - data);
+      if (this->searched < this->end) {
+        auto const arg = std::string_view(data + this->begin, this->searched - this->begin);
+        this->begin = this->searched = this->searched + 1;
+        return arg;
+      }
+      if (this->eof) {
+        if (this->begin == this->end) return std::nullopt;
+        auto const arg = std::string_view(data + this->begin, this->end - this->begin);
+        this->begin = this->searched = this->end;
+        return arg;
+      }
+    } else if (this->eof) return std::nullopt;
+    this->read_more();
+  }
+}
+
+void ArgStream::read_more() {
+  if (this->chunks.empty() || this->end == this->chunks.back().size) {
+    // the chunk is full, so the (partial) argument at its end moves to a new one, with room for it to keep growing
+    auto const pending = this->end - this->begin;
+    auto const size = std::max(this->chunk_size, 2 * pending);
+    auto *const data = static_cast<char *>(this->mem_resource->allocate(size, 1));
+    if (pending > 0) std::memcpy(data, this->chunks.back().data + this->begin, pending);
+    // no argument was returned from the previous chunk if the pending one started at its beginning
+    if (!this->chunks.empty() && this->begin == 0) {
+      this->mem_resource->deallocate(this->chunks.back().data, this->chunks.back().size, 1);
+      this->chunks.pop_back();
+    }
+    this->chunks.push_back(Chunk{.data = data, .size = size});
+    this->searched -= this->begin;
+    this->begin = 0;
+    this->end = pending;
+  }
+
+  auto const &chunk = this->chunks.back();
+  ssize_t amount_read = 0;
+  do {
+    amount_read = ::read(this->fd, chunk.data + this->end, chunk.size - this->end);
+  } while (amount_read == -1 && errno == EINTR);
+  if (amount_read == -1) throw ArgStreamError(this->fd, std::strerror(errno));
+  if (amount_read == 0) this->eof = true;
+  else this->end += static_cast<std::size_t>(amount_read);
+}
+
+void ArgStream::release() noexcept {
+  for (auto const chunk : this->chunks) {
+    this->mem_resource->deallocate(chunk.data, chunk.size, 1);
+  }
+  this->chunks.clear();
+}
+
+} // namespace opz
@@ -1,5 +1,8 @@
 #include "opzioni/cmd_fmt.hpp"
 
+#include <iterator>
+#include <ranges>
+
 namespace opz {
 
 // +--------------------------------------+
@@ -8,7 +11,13 @@ namespace opz {
 
 [[nodiscard]] std::string CmdHelpEntry::format_for_usage() const noexcept { return std::string(name); }
 
-[[nodiscard]] std::string CmdHelpEntry::format_for_index_entry() const noexcept { return std::string(name); }
+[[nodiscard]] std::string CmdHelpEntry::format_for_index_entry() const noexcept {
+  std::string entry(name);
+  for (auto const alias : aliases) {
+    if (!alias.empty()) entry.append(", ").append(alias);
+  }
+  return entry;
+}
 
 [[nodiscard]] std::string CmdHelpEntry::format_for_index_description() const noexcept {
   return std::string(introduction);
@@ -63,23 +72,69 @@ namespace opz {
   // fmt::arg("gather_amount", gather_amount));
 }
 
+// +--------------------------------------+
+// |             WrappedLines             |
+// +--------------------------------------+
+
+static void append(fmt::memory_buffer &out, std::string_view const str) {
+  out.append(str.data(), str.data() + str.size());
+}
+
+// Wraps words in lines as `Paragraph` does, but appends them to `out` right away instead of keeping each of them in a
+// string. Every line but the first (which the caller may have started) begins with `indent`.
+class WrappedLines {
+public:
+
+  WrappedLines(fmt::memory_buffer &out, std::size_t const max_width, std::string_view const indent) noexcept
+    : out(out), indent(indent), max_width(max_width), width_left(max_width) {}
+
+  void add_word(std::string_view const word) {
+    if (word.length() < this->width_left) {
+      if (!this->is_line_empty) this->out.push_back(' ');
+      this->width_left -= (word.length() + 1); // +1 for space in between
+    } else {
+      this->out.push_back(nl);
+      append(this->out, this->indent);
+      this->width_left = this->max_width - word.length();
+    }
+    append(this->out, word);
+    this->is_line_empty = false;
+  }
+
+  void add_words_of(std::string_view const line) {
+    for (auto const word : line | std::views::split(' ')) {
+      this->add_word({word.begin(), word.end()});
+    }
+  }
+
+private:
+
+  fmt::memory_buffer &out;
+  std::string_view indent;
+  std::size_t max_width;
+  std::size_t width_left;
+  bool is_line_empty{true};
+};
+
 // +--------------------------------------+
 // |                CmdFmt                |
 // +--------------------------------------+
 
-void CmdFmt::print_title(std::FILE *f) const noexcept {
+void CmdFmt::format_title(fmt::memory_buffer &out) const {
+  auto const inserter = std::back_inserter(out);
   if (!parent_cmds_names.empty()) {
-    fmt::print(f, "{} ", fmt::join(parent_cmds_names, " "));
+    fmt::format_to(inserter, "{} ", fmt::join(parent_cmds_names, " "));
   }
-  fmt::print(f, "{}{: >{}}\n", name, version, version.size() + static_cast<int>(!version.empty()));
+  fmt::format_to(inserter, "{}{: >{}}\n", name, version, version.size() + static_cast<int>(!version.empty()));
 }
 
-void CmdFmt::print_intro(std::FILE *f) const noexcept {
+void CmdFmt::format_intro(fmt::memory_buffer &out) const {
   if (introduction.length() <= msg_width) {
-    fmt::print(f, "{}\n", introduction);
+    append(out, introduction);
   } else {
-    fmt::print(f, "{}\n", limit_line_within(introduction, msg_width).to_str_lines());
+    WrappedLines(out, msg_width, "").add_words_of(introduction);
   }
+  out.push_back(nl);
 }
 
 std::string format_group(
@@ -98,8 +153,8 @@ std::string format_group(
   return line;
 }
 
-void CmdFmt::print_usage(std::FILE *f) const noexcept {
-  using fmt::format, fmt::join;
+void CmdFmt::format_usage(fmt::memory_buffer &out) const {
+  using fmt::format;
   using std::ranges::transform;
   using std::views::drop, std::views::take;
 
@@ -122,25 +177,26 @@ void CmdFmt::print_usage(std::FILE *f) const noexcept {
   }
 
   if (subcmds.size() == 1) {
-    words.push_back(format("{{{}}}", subcmds.front().format_for_index_entry()));
+    words.push_back(format("{{{}}}", subcmds.front().format_for_usage()));
   } else if (subcmds.size() > 1) {
-    // don't need space after commas because we'll join words with spaces afterwards
-    words.push_back(format("{{{},", subcmds.front().format_for_index_entry()));
+    // don't need space after commas because words are joined with spaces afterwards
+    words.push_back(format("{{{},", subcmds.front().format_for_usage()));
     transform(
-      subcmds | drop(1) | take(subcmds.size() - 2), std::back_inserter(words), &CmdHelpEntry::format_for_index_entry
+      subcmds | drop(1) | take(subcmds.size() - 2), std::back_inserter(words), &CmdHelpEntry::format_for_usage
     );
-    words.push_back(format("{}}}", subcmds.back().format_for_index_entry()));
+    words.push_back(format("{}}}", subcmds.back().format_for_usage()));
   }
 
-  // -2 because we'll print a left margin of 2 spaces in the for-loop below
-  auto const paragraph = limit_within(std::span(words), msg_width - 2);
-  fmt::print(f, "USAGE:\n");
-  for (auto const &line : paragraph.lines()) {
-    fmt::print(f, "  {}\n", join(line.words(), " "));
+  append(out, "USAGE:\n  ");
+  // -2 because every line has a left margin of 2 spaces
+  WrappedLines lines(out, msg_width - 2, "  ");
+  for (auto const &word : words) {
+    lines.add_word(word);
   }
+  out.push_back(nl);
 }
 
-void CmdFmt::print_help(std::FILE *f) const noexcept {
+void CmdFmt::format_help(fmt::memory_buffer &out) const {
   using std::ranges::to;
   using std::views::transform;
 
@@ -155,30 +211,23 @@ void CmdFmt::print_help(std::FILE *f) const noexcept {
     subcmd_index_entries.empty() ? 0 : std::ranges::max(subcmd_index_entries | transform(&std::string::length));
   auto const padding_size = std::max(required_length_args, required_length_cmds);
 
-  std::string_view pending_nl;
   if (!args.empty()) {
-    fmt::print(f, "ARGUMENTS:\n");
-    int i = 0;
-    for (auto const &arg : args) {
-      print_arg_help(f, arg_index_entries[i], arg.format_for_index_description(), padding_size);
-      i += 1;
+    append(out, "ARGUMENTS:\n");
+    for (std::size_t i = 0; i < args.size(); ++i) {
+      format_arg_help(out, arg_index_entries[i], args[i].format_for_index_description(), padding_size);
     }
-    pending_nl = "\n";
-  } else {
-    pending_nl = "";
   }
 
   if (!subcmds.empty()) {
-    fmt::print(f, "{}SUBCOMMANDS:\n", pending_nl);
-    int i = 0;
-    for (auto const &subcmd : subcmds) {
-      print_arg_help(f, subcmd_index_entries[i], subcmd.format_for_index_description(), padding_size);
-      i += 1;
+    if (!args.empty()) out.push_back(nl);
+    append(out, "SUBCOMMANDS:\n");
+    for (std::size_t i = 0; i < subcmds.size(); ++i) {
+      format_arg_help(out, subcmd_index_entries[i], subcmds[i].format_for_index_description(), padding_size);
     }
   }
 }
 
-void CmdFmt::print_details(std::FILE *f) const noexcept {
+void CmdFmt::format_details(fmt::memory_buffer &) const {
   // if (details.empty())
   //   return;
   // if (details.length() <= msg_width)
@@ -187,19 +236,74 @@ void CmdFmt::print_details(std::FILE *f) const noexcept {
   //   out << limit_string_within(details, msg_width) << nl;
 }
 
-void CmdFmt::print_arg_help(
-  std::FILE *f, std::string const &index_entry, std::string const &index_description, std::size_t const padding_size
-) const noexcept {
+void CmdFmt::format_arg_help(
+  fmt::memory_buffer &out,
+  std::string_view const index_entry,
+  std::string_view const index_description,
+  std::size_t const padding_size
+) const {
+  fmt::format_to(std::back_inserter(out), "  {:<{}}    ", index_entry, padding_size);
+  // the same 2 spaces of left margin and padding (of at least 1), then additional 4 spaces of indentation
+  std::string const indent(2 + std::max(padding_size, std::size_t{1}) + 6, ' ');
   // -8 because we print 2 spaces of left margin and 2 spaces of indentation for descriptions longer than 1 line
   // then add 4 spaces between the arg usage and description
-  auto const paragraph = limit_line_within(index_description, msg_width - padding_size - 8);
-
-  fmt::print(f, "  {:<{}}    {}\n", index_entry, padding_size, fmt::join(paragraph.lines().front().words(), " "));
+  WrappedLines(out, msg_width - padding_size - 8, indent).add_words_of(index_description);
+  out.push_back(nl);
+}
 
-  for (auto const &line : paragraph.lines() | std::views::drop(1)) {
-    // the same 2 spaces of left margin, then additional 4 spaces of indentation
-    fmt::print(f, "  {: >{}}      {}\n", ' ', padding_size, fmt::join(line.words(), " "));
+void CmdFmt::format_help_page(fmt::memory_buffer &out) const {
+  format_title(out);
+  if (!introduction.empty()) {
+    out.push_back(nl);
+    format_intro(out);
   }
+  out.push_back(nl);
+  format_usage(out);
+  out.push_back(nl);
+  format_help(out);
+  out.push_back(nl);
+  format_details(out);
+}
+
+void CmdFmt::print_title(std::FILE *f) const noexcept {
+  fmt::memory_buffer out;
+  format_title(out);
+  write_buffer(f, out);
+}
+
+void CmdFmt::print_intro(std::FILE *f) const noexcept {
+  fmt::memory_buffer out;
+  format_intro(out);
+  write_buffer(f, out);
+}
+
+void CmdFmt::print_usage(std::FILE *f) const noexcept {
+  fmt::memory_buffer out;
+  format_usage(out);
+  write_buffer(f, out);
+}
+
+void CmdFmt::print_help(std::FILE *f) const noexcept {
+  fmt::memory_buffer out;
+  format_help(out);
+  write_buffer(f, out);
+}
+
+void CmdFmt::print_details(std::FILE *f) const noexcept {
+  fmt::memory_buffer out;
+  format_details(out);
+  write_buffer(f, out);
+}
+
+void CmdFmt::print_help_page(std::FILE *f) const noexcept {
+  fmt::memory_buffer out;
+  format_help_page(out);
+  write_buffer(f, out);
+}
+
+void write_buffer(std::FILE *f, fmt::memory_buffer const &buffer) noexcept {
+  std::fwrite(buffer.data(), 1, buffer.size(), f);
+  std::fflush(f);
 }
 
 } // namespace opz
@@ -0,0 +1,122 @@
+#include "opzioni/command_line.hpp"
+#include "opzioni/exceptions.hpp"
+#include "opzioni/simd.hpp"
+#include "opzioni/strings.hpp"
+
+#include <functional>
+#include <utility>
+
+namespace opz {
+
+// +--------------------------------+
+// |        byte classifier         |
+// +--------------------------------+
+
+[[nodiscard]] static bool is_space(char const ch) noexcept { return whitespace.find(ch) != std::string_view::npos; }
+
+// Index of the first byte at or after `idx` that ends an argument or makes it need unescaping
+[[nodiscard]] static std::size_t find_special(std::string_view const str, std::size_t const idx) noexcept {
+  return find_any<' ', '\f', '\n', '\r', '\t', '\v', '\'', '"', '\\'>(str, idx);
+}
+
+// +--------------------------------+
+// |          CommandLine           |
+// +--------------------------------+
+
+CommandLine::CommandLine(std::pmr::memory_resource *const mem_resource) noexcept
+  : args(mem_resource), unescaped(mem_resource) {}
+
+CommandLine &CommandLine::operator=(CommandLine &&other) {
+  auto const *const other_begin = other.unescaped.data();
+  auto const *const other_end = other_begin + other.unescaped.size();
+  this->args = std::move(other.args);
+  this->unescaped = std::move(other.unescaped);
+  // with different memory resources, the unescaped arguments are copied instead of moved, so views have to follow them
+  if (this->unescaped.data() != other_begin) {
+    for (auto &arg : this->args) {
+      if (std::less_equal{}(other_begin, arg.data()) && std::less_equal{}(arg.data(), other_end))
+        arg = std::string_view(this->unescaped.data() + (arg.data() - other_begin), arg.size());
+    }
+  }
+  return *this;
+}
+
+void CommandLine::reset(std::string_view const line) {
+  this->args.clear();
+  this->unescaped.clear();
+  this->unescaped.reserve(line.size());
+  for (std::size_t idx = 0;;) {
+    while (idx < line.size() && is_space(line[idx])) {
+      ++idx;
+    }
+    if (idx == line.size()) return;
+    // most arguments have nothing to unescape, so they are taken as they are
+    if (auto const end = find_special(line, idx); end == line.size() || is_space(line[end])) {
+      this->args.push_back(line.substr(idx, end - idx));
+      idx = end;
+    } else {
+      idx = this->unescaped_arg(line, idx);
+    }
+  }
+}
+
+/* private */
+
+// Adds the argument starting at `idx`, which has quotes or escapes, and returns the index right after it
+std::size_t CommandLine::unescaped_arg(std::string_view const line, std::size_t idx) {
+  auto const begin = this->unescaped.size();
+  auto const append = [this, line](std::size_t const from, std::size_t const to) {
+    this->unescaped.insert(this->unescaped.end(), line.begin() + from, line.begin() + to);
+  };
+  bool has_quotes = false;
+  while (idx < line.size() && !is_space(line[idx])) {
+    switch (line[idx]) {
+      case '\'': {
+        auto const close = line.find('\'', idx + 1);
+        if (close == std::string_view::npos) throw CommandLineError(idx + 1, "unterminated single quote");
+        append(idx + 1, close);
+        has_quotes = true;
+        idx = close + 1;
+        break;
+      }
+      case '"': {
+        auto const open = idx++;
+        while (true) {
+          auto const special = find_any<'"', '\\'>(line, idx);
+          append(idx, special);
+          if (special == line.size()) throw CommandLineError(open + 1, "unterminated double quote");
+          if (line[special] == '"') {
+            idx = special + 1;
+            break;
+          }
+          // inside double quotes, a backslash only escapes the characters that would be special there
+          if (special + 1 == line.size()) throw CommandLineError(open + 1, "unterminated double quote");
+          if (auto const next = line[special + 1]; next == '"' || next == '\\' || next == '$' || next == '`')
+            this->unescaped.push_back(next);
+          else if (next != nl) append(special, special + 2);
+          idx = special + 2;
+        }
+        has_quotes = true;
+        break;
+      }
+      case '\\': {
+        if (idx + 1 == line.size()) throw CommandLineError(idx + 1, "nothing to escape after a backslash");
+        // an escaped newline is a line continuation, which is removed
+        if (line[idx + 1] != nl) this->unescaped.push_back(line[idx + 1]);
+        idx += 2;
+        break;
+      }
+      default: {
+        auto const special = find_special(line, idx);
+        append(idx, special);
+        idx = special;
+      }
+    }
+  }
+  // e.g. a lone line continuation isn't an (empty) argument, while `''` is
+  if (has_quotes || this->unescaped.size() > begin)
+    this->args.emplace_back(this->unescaped.data() + begin, this->unescaped.size() - begin);
+  return idx;
+}
+
+} // namespace opz
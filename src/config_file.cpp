@@ -0,0 +1,54 @@
+#include "opzioni/config_file.hpp"
+#include "opzioni/exceptions.hpp"
+#include "opzioni/strings.hpp"
+
+#include <algorithm>
+
+namespace opz {
+
+static std::string_view trim(std::string_view str) noexcept {
+  str.remove_prefix(std::min(str.find_first_not_of(whitespace), str.size()));
+  str.remove_suffix(str.size() - std::min(str.find_last_not_of(whitespace) + 1, str.size()));
+  return str;
+}
+
+std::pmr::vector<ConfigEntry>
+parse_config(std::string_view const path, std::string_view contents, std::pmr::memory_resource *const mem_resource) {
+  std::pmr::vector<ConfigEntry> entries(mem_resource);
+  std::string_view section;
+  for (std::size_t line_number = 1; !contents.empty(); ++line_number) {
+    auto const line_end = std::min(contents.find(nl), contents.size());
+    auto const line = trim(contents.substr(0, line_end));
+    contents.remove_prefix(std::min(line_end + 1, contents.size()));
+    if (line.empty() || line.front() == '#' || line.front() == ';') continue;
+
+    if (line.front() == '[') {
+      if (line.back() != ']') throw ConfigFileError(path, line_number, "section header is missing `]`");
+      section = trim(line.substr(1, line.size() - 2));
+      continue;
+    }
+
+    auto const eq_idx = line.find('=');
+    if (eq_idx == std::string_view::npos) throw ConfigFileError(path, line_number, "expected `key = value`");
+    auto const key = trim(line.substr(0, eq_idx));
+    if (key.empty()) throw ConfigFileError(path, line_number, "missing key before `=`");
+    auto value = trim(line.substr(eq_idx + 1));
+    if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front())
+      value = value.substr(1, value.size() - 2);
+    entries.push_back(ConfigEntry{.section = section, .key = key, .value = value, .line = line_number});
+  }
+  return entries;
+}
+
+[[nodiscard]] bool is_section_of(std::string_view section, std::span<std::string_view const> const cmd_path) noexcept {
+  for (std::size_t i = 0; i < cmd_path.size(); ++i) {
+    if (!section.starts_with(cmd_path[i])) return false;
+    section.remove_prefix(cmd_path[i].size());
+    if (section.empty()) return i + 1 == cmd_path.size();
+    if (section.front() != '.') return false;
+    section.remove_prefix(1);
+  }
+  return section.empty();
+}
+
+} // namespace opz
@@ -2,12 +2,44 @@
 
 namespace opz {
 
+[[noreturn]] void
+throw_conversion_error(std::string_view const value, std::string_view const type, ConversionErrc const errc) {
+  switch (errc) {
+    case ConversionErrc::empty: throw ConversionError("empty string", type);
+    case ConversionErrc::out_of_range: throw ValueOutOfRange(value, type);
+    case ConversionErrc::invalid: break;
+  }
+  throw ConversionError(value, type);
+}
+
+auto parse_prefixed_integer(std::string_view const value) noexcept -> std::expected<SignedMagnitude, ConversionErrc> {
+  auto digits = value;
+  bool const is_negative = strip_sign(digits);
+  int const base = strip_base_prefix(digits);
+  // `std::from_chars` doesn't take a plus, but would take a minus, and there may only be one sign
+  if (digits.empty() || digits.front() == '-' || digits.front() == '+') return std::unexpected(ConversionErrc::invalid);
+  std::uintmax_t magnitude = 0;
+  auto const *const end = digits.data() + digits.size();
+  auto const conv_result = std::from_chars(digits.data(), end, magnitude, base);
+  if (conv_result.ec == std::errc::invalid_argument || conv_result.ptr != end)
+    return std::unexpected(ConversionErrc::invalid);
+  if (conv_result.ec == std::errc::result_out_of_range) return std::unexpected(ConversionErrc::out_of_range);
+  return SignedMagnitude{magnitude, is_negative};
+}
+
 template <>
-auto convert<bool>(std::string_view value) -> bool {
-  if (value.empty()) throw ConversionError("empty string", "bool");
+auto try_convert<bool>(std::string_view value) noexcept -> std::expected<bool, ConversionErrc> {
+  if (value.empty()) return std::unexpected(ConversionErrc::empty);
   if (value == "1" || value == "true") return true;
   if (value == "0" || value == "false") return false;
-  throw ConversionError(value, "bool");
+  return std::unexpected(ConversionErrc::invalid);
+}
+
+template <>
+auto convert<bool>(std::string_view value) -> bool {
+  auto const boolean = try_convert<bool>(value);
+  if (!boolean) throw_conversion_error(value, "bool", boolean.error());
+  return *boolean;
 }
 
 template <>
@@ -0,0 +1,55 @@
+#include "opzioni/env.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+extern char **environ; // NOLINT: POSIX
+
+namespace opz {
+
+void read_env(
+  EnvLookup const &lookup,
+  std::span<std::optional<std::string_view>> const found,
+  std::pmr::memory_resource *const mem_resource
+) {
+  // open addressing table of the explicitly bound variables, so that each variable is checked against all of them at
+  // once instead of against each one of them
+  auto const amount_explicit = static_cast<std::size_t>(
+    std::ranges::count_if(lookup.explicit_names, [](auto const name) { return !name.empty(); })
+  );
+  if (amount_explicit == 0 && lookup.prefix.empty()) return;
+  auto const mask = amount_explicit == 0 ? 0 : std::bit_ceil(2 * amount_explicit) - 1;
+  std::pmr::vector<int> table(amount_explicit == 0 ? 0 : mask + 1, -1, mem_resource);
+  for (std::size_t arg_idx = 0; arg_idx < lookup.explicit_names.size(); ++arg_idx) {
+    if (lookup.explicit_names[arg_idx].empty()) continue;
+    auto slot = hash_str(lookup.explicit_names[arg_idx], 0) & mask;
+    while (table[slot] != -1)
+      slot = (slot + 1) & mask;
+    table[slot] = static_cast<int>(arg_idx);
+  }
+
+  for (char **var = environ; var != nullptr && *var != nullptr; ++var) {
+    std::string_view const entry(*var);
+    auto const eq_idx = entry.find('=');
+    if (eq_idx == std::string_view::npos) continue;
+    auto const name = entry.substr(0, eq_idx), value = entry.substr(eq_idx + 1);
+
+    if (!table.empty()) {
+      for (auto slot = hash_str(name, 0) & mask; table[slot] != -1; slot = (slot + 1) & mask) {
+        if (lookup.explicit_names[table[slot]] == name) {
+          found[table[slot]] = value;
+          break;
+        }
+      }
+    }
+    if (!lookup.prefix.empty() && name.starts_with(lookup.prefix)) {
+      auto const arg_idx =
+        find_in_perfect_hash(lookup.keys, lookup.seeds, lookup.values, name.substr(lookup.prefix.size()));
+      // an explicitly bound variable replaces the derived one
+      if (arg_idx != -1 && lookup.explicit_names[arg_idx].empty()) found[arg_idx] = value;
+    }
+  }
+}
+
+} // namespace opz
@@ -1,11 +1,89 @@
 #include "opzioni/cmd.hpp"
 #include "opzioni/exceptions.hpp"
+#include "opzioni/outcome.hpp"
 #include "opzioni/strings.hpp"
 
 #include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <utility>
 
 namespace opz {
 
+std::string format_message(ParseError const &error) {
+  switch (error.kind) {
+    case ErrorKind::MISSING_REQUIRED_ARGUMENT:
+      return fmt::format("Missing required argument `{}` for command `{}`", error.arg_name, error.cmd_name);
+    case ErrorKind::UNEXPECTED_POSITIONAL:
+      return fmt::format(
+        "Unexpected positional argument for `{}`: `{}` (only {} are expected)",
+        error.cmd_name,
+        error.input,
+        error.expected_amount
+      );
+    case ErrorKind::UNKNOWN_ARGUMENTS:
+      return fmt::format("Unknown arguments for `{}` command: `{}`", error.cmd_name, error.input);
+    case ErrorKind::UNKNOWN_SUBCOMMAND:
+      return fmt::format("Unknown subcommand `{}` for command `{}`", error.input, error.cmd_name);
+    case ErrorKind::CONFLICTING_ARGUMENTS:
+      return fmt::format(
+        "Arguments `{}` and `{}` for command `{}` are mutually exclusive. Please check help for more details",
+        error.input,
+        error.other_input,
+        error.cmd_name
+      );
+    case ErrorKind::MISSING_ALL_REQUIRED_GROUPED_ARGUMENTS:
+      return fmt::format(
+        "Argument `{}` of command `{}` is missing and it is part of a group which requires that either all"
+        " or none of its arguments be present. Please check help for more details",
+        error.arg_name,
+        error.cmd_name
+      );
+    case ErrorKind::MISSING_MUTUALLY_EXCLUSIVE_GROUPED_ARGUMENTS:
+      return fmt::format(
+        "Argument `{}` of command `{}` is missing and it is part of a group which requires that exactly"
+        " one of its arguments be present. Please check help for more details",
+        error.arg_name,
+        error.cmd_name
+      );
+    case ErrorKind::INVALID_INPUT:
+      try {
+        std::rethrow_exception(error.cause);
+      } catch (std::exception const &e) {
+        return e.what();
+      }
+  }
+  return {};
+}
+
+char const *UserError::what() const noexcept {
+  if (this->message.empty()) {
+    try {
+      this->message = format_message(this->error);
+    } catch (...) {
+      return "Invalid command line";
+    }
+  }
+  return this->message.c_str();
+}
+
+void throw_user_error(ParseError error, LazyCmdFmt formatter) {
+  switch (error.kind) {
+    case ErrorKind::MISSING_REQUIRED_ARGUMENT: throw MissingRequiredArgument(std::move(error), std::move(formatter));
+    case ErrorKind::UNEXPECTED_POSITIONAL: throw UnexpectedPositional(std::move(error), std::move(formatter));
+    case ErrorKind::UNKNOWN_ARGUMENTS: throw UnknownArguments(std::move(error), std::move(formatter));
+    case ErrorKind::UNKNOWN_SUBCOMMAND: throw UnknownSubcommand(std::move(error), std::move(formatter));
+    case ErrorKind::CONFLICTING_ARGUMENTS: throw ConflictingArguments(std::move(error), std::move(formatter));
+    case ErrorKind::MISSING_ALL_REQUIRED_GROUPED_ARGUMENTS:
+      throw MissingAllRequiredGroupedArguments(std::move(error), std::move(formatter));
+    case ErrorKind::MISSING_MUTUALLY_EXCLUSIVE_GROUPED_ARGUMENTS:
+      throw MissingMutuallyExclusiveGroupedArguments(std::move(error), std::move(formatter));
+    case ErrorKind::INVALID_INPUT: break;
+  }
+  throw UserError(std::move(error), std::move(formatter));
+}
+
 int print_error(UserError &ue) noexcept {
   auto const msg = limit_line_within(ue.what(), ue.formatter.msg_width).to_str_lines();
   std::fputs(msg.c_str(), stderr);
@@ -13,12 +91,46 @@ int print_error(UserError &ue) noexcept {
 }
 
 int print_error_and_usage(UserError &ue) noexcept {
-  print_error(ue);
-  std::fputc(nl, stderr);
-  ue.formatter.print_usage(stderr);
+  fmt::memory_buffer out;
+  fmt::format_to(std::back_inserter(out), "{}\n", limit_line_within(ue.what(), ue.formatter.msg_width).to_str_lines());
+  ue.formatter.format_usage(out);
+  write_buffer(stderr, out);
   return -1;
 }
 
 int rethrow(UserError &ue) { throw ue; }
 
+std::string ParseOutcome::message() const { return this->is_error() ? format_message(this->error) : std::string(); }
+
+int ParseOutcome::print(std::FILE *const out, std::FILE *const err) const noexcept {
+  fmt::memory_buffer buffer;
+  switch (this->kind) {
+    case OutcomeKind::HELP:
+      this->formatter.get().format_help_page(buffer);
+      write_buffer(out, buffer);
+      return 0;
+    case OutcomeKind::VERSION: {
+      auto const cmd_fmt = this->formatter.get();
+      fmt::format_to(std::back_inserter(buffer), "{} {}\n", cmd_fmt.name, cmd_fmt.version);
+      write_buffer(out, buffer);
+      return 0;
+    }
+    case OutcomeKind::USER_ERROR: {
+      UserError const ue(this->error, this->formatter);
+      fmt::format_to(
+        std::back_inserter(buffer), "{}\n", limit_line_within(ue.what(), this->formatter.msg_width).to_str_lines()
+      );
+      this->formatter.format_usage(buffer);
+      write_buffer(err, buffer);
+      return -1;
+    }
+  }
+  return -1;
+}
+
+void ParseOutcome::raise() const {
+  if (this->is_error()) throw_user_error(this->error, this->formatter);
+  std::exit(this->print());
+}
+
 } // namespace opz
@@ -0,0 +1,545 @@
+#include "opzioni/parser_core.hpp"
+
+#include <cerrno>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "opzioni/converters.hpp"
+#include "opzioni/env.hpp"
+#include "opzioni/exceptions.hpp"
+
+namespace opz {
+
+ParserCore::ParserCore(CmdDesc const &desc, void const *const cmd, std::pmr::memory_resource *const mem_resource)
+  : desc(&desc),
+    cmd(cmd),
+    mem_resource(mem_resource),
+    with_value(mem_resource),
+    parsed_group_members(mem_resource),
+    config_entries(mem_resource) {
+  auto const view = desc.view(cmd);
+  this->cmd_name = view.name;
+  this->env_prefix = view.env_prefix;
+  this->lazy_conversion = view.lazy_conversion;
+  this->response_files = view.response_files;
+  this->args = view.args;
+}
+
+ParserCore::ParserCore(CmdDesc const &desc, void const *const cmd, ParserCore const &parent)
+  : ParserCore(desc, cmd, parent.mem_resource) {
+  this->inherit_from(parent);
+}
+
+void ParserCore::inherit_from(ParserCore const &parent) {
+  this->config = parent.config;
+  this->extra_info.parent_cmds_names = parent.extra_info.parent_cmds_names;
+  this->extra_info.parent_cmds_names.push_back(parent.cmd_name);
+}
+
+// +-----------------------+
+// |       scanning        |
+// +-----------------------+
+
+ParseResult ParserCore::rescan(Scanner &scanner, std::span<char const *> const args) const {
+  try {
+    scanner.reset(args, CmdRef{this->cmd, this->desc->schema}, this->response_files);
+  } catch (std::runtime_error const &) { // e.g. FileError and ResponseFileError
+    return this->fail(this->invalid_input(std::current_exception()));
+  }
+  return {};
+}
+
+ParseResult
+ParserCore::rescan(Scanner &scanner, CommandLine &command_line, std::string_view const line) const {
+  try {
+    command_line.reset(line);
+  } catch (CommandLineError const &) {
+    return this->fail(this->invalid_input(std::current_exception()));
+  }
+  // the arguments go straight into the scanner, with no array of C strings in between
+  scanner.reset({}, CmdRef{this->cmd, this->desc->schema});
+  scanner.push(this->cmd_name);
+  for (auto const arg : command_line.get_args()) {
+    scanner.push(arg);
+  }
+  return {};
+}
+
+ParseResult ParserCore::scan_stream(Scanner &scanner, ArgStream &stream) const {
+  try {
+    while (auto const arg = stream.next()) {
+      scanner.push(*arg);
+    }
+  } catch (ArgStreamError const &) {
+    return this->fail(this->invalid_input(std::current_exception()));
+  }
+  return {};
+}
+
+std::expected<std::optional<MappedFile>, ParseOutcome> ParserCore::load_config(ConfigFile const &config) {
+  std::optional<MappedFile> file;
+  try {
+    file.emplace(config.path);
+    this->config_entries = parse_config(config.path, file->contents(), this->mem_resource);
+  } catch (FileError const &e) {
+    if (!config.is_optional || e.error_number != ENOENT)
+      return this->fail(this->invalid_input(std::current_exception()));
+  } catch (ConfigFileError const &) {
+    return this->fail(this->invalid_input(std::current_exception()));
+  }
+  this->config = ConfigLayer{.path = config.path, .entries = this->config_entries};
+  return file;
+}
+
+// +-----------------------+
+// |        parsing        |
+// +-----------------------+
+
+ParseResult ParserCore::parse(void *const map, Scanner &scanner) {
+  this->parsed_group_members.clear();
+  this->extra_info.exit_request.reset();
+  auto const tokens = scanner();
+  return this->fill_args_map(map, scanner.get_args(), tokens, 0);
+}
+
+ParseResult ParserCore::fill_args_map(
+  void *const map,
+  std::span<std::string_view const> const args,
+  std::span<Token const> const tokens,
+  std::size_t const recursion_start_idx
+) {
+  this->desc->init_map(map, this->cmd, *tokens[recursion_start_idx].value);
+  this->with_value.assign(this->args.size(), false);
+  // the arguments of this command are up to its subcommand, if any, which the scanner already told apart
+  auto recursion_end_idx = recursion_start_idx;
+  while (recursion_end_idx + 1 < tokens.size() && tokens[recursion_end_idx + 1].kind != TokenKind::SUBCMD) {
+    recursion_end_idx += 1;
+  }
+  if (this->desc->has_subcmds) {
+    if (auto result = this->parse_subcmd(map, args, tokens, recursion_start_idx, recursion_end_idx); !result)
+      return result;
+  }
+  // further args have to be
+  // > recursion_start_idx (because at recursion_start_idx is the subcmd)
+  // and <= recursion_end_idx
+  TokenBitset consumed_indices(recursion_start_idx, recursion_end_idx - recursion_start_idx + 1, this->mem_resource);
+  consumed_indices.insert(recursion_start_idx);
+  if (auto result = this->process_tokens(map, tokens, recursion_start_idx, recursion_end_idx, consumed_indices); !result)
+    return result;
+  return this->check_unknown_args(args, tokens, consumed_indices);
+}
+
+ParseResult ParserCore::parse_subcmd(
+  void *const map,
+  std::span<std::string_view const> const args,
+  std::span<Token const> const tokens,
+  std::size_t const recursion_start_idx,
+  std::size_t const recursion_end_idx
+) const {
+  if (recursion_end_idx + 1 < tokens.size()) {
+    auto const tok_idx = recursion_end_idx + 1;
+    auto result = this->desc->parse_subcmd(map, this->cmd, tokens[tok_idx].slot, *this, args, tokens, tok_idx);
+    if (!result) return result;
+  }
+  // Note: a command can't have positionals if it has subcommands, so any identifier that the scanner didn't recognize
+  // as a subcommand means that the user provided an unknown one
+  for (auto idx = recursion_start_idx + 1; idx <= recursion_end_idx; ++idx) {
+    if (tokens[idx].kind == TokenKind::IDENTIFIER) {
+      return this->fail(ParseError{
+        .kind = ErrorKind::UNKNOWN_SUBCOMMAND,
+        .cmd_name = this->cmd_name,
+        .tok_idx = idx,
+        .input = std::string(*tokens[idx].value),
+      });
+    }
+  }
+  return {};
+}
+
+// Walks the tokens of this command once, dispatching each one to the argument it belongs to. Options and flags know
+// their argument from the scanner, while the n-th positional token goes to the n-th positional argument.
+ParseResult ParserCore::process_tokens(
+  void *const map,
+  std::span<Token const> const tokens,
+  std::size_t const recursion_start_idx,
+  std::size_t const recursion_end_idx,
+  TokenBitset &consumed_indices
+) {
+  auto const args_size = this->args.size();
+  auto const pos_slots = this->desc->pos_slots;
+  auto const indices = index_tokens(tokens, args_size, recursion_start_idx, recursion_end_idx, this->mem_resource);
+  std::size_t cur_pos_idx = 0;
+  for (auto idx = recursion_start_idx + 1; idx <= recursion_end_idx; ++idx) {
+    switch (auto const &tok = tokens[idx]; tok.kind) {
+      case TokenKind::DASH_DASH: consumed_indices.insert(idx); break;
+      case TokenKind::IDENTIFIER: {
+        if (cur_pos_idx >= pos_slots.size()) break;
+        consumed_indices.insert(idx);
+        if (auto result = this->consume_from_tokens(map, pos_slots[cur_pos_idx++], tokens, indices, idx); !result)
+          return result;
+        break;
+      }
+      case TokenKind::FLG: [[fallthrough]];
+      case TokenKind::OPT_OR_FLG_LONG: [[fallthrough]];
+      case TokenKind::OPT_LONG_AND_VALUE: [[fallthrough]];
+      case TokenKind::OPT_SHORT_AND_VALUE: {
+        // positionals are never looked up by name
+        if (tok.slot == -1 || this->args[tok.slot].kind == ArgKind::POS) break;
+        consumed_indices.insert(idx);
+        // all occurrences of an option or flag are consumed together, at the first one
+        if (indices.occurrences_of(tok.slot).front() != idx) break;
+        auto result = this->consume_from_tokens(map, static_cast<std::size_t>(tok.slot), tokens, indices, idx);
+        if (!result) return result;
+        break;
+      }
+      case TokenKind::PROG_NAME: [[fallthrough]];
+      case TokenKind::SUBCMD: [[fallthrough]];
+      default: break;
+    }
+  }
+  cur_pos_idx = 0;
+  auto const env_values = this->read_env_values();
+  auto const config_tokens = this->get_config_tokens();
+  if (!config_tokens) return std::unexpected(config_tokens.error());
+  auto const config_indices =
+    index_tokens(*config_tokens, args_size, 0, config_tokens->size() - 1, this->mem_resource);
+  for (std::size_t arg_idx = 0; arg_idx < args_size; ++arg_idx) {
+    if (auto result = this->post_process_arg(arg_idx, tokens, indices, cur_pos_idx); !result) return result;
+  }
+  // the command line has precedence over the environment, which has precedence over the config file
+  for (std::size_t arg_idx = 0; arg_idx < args_size; ++arg_idx) {
+    auto result = this->consume_fallback(map, arg_idx, this->env_values_of(env_values[arg_idx]), ArgOrigin::ENV);
+    if (!result) return result;
+  }
+  for (std::size_t arg_idx = 0; arg_idx < args_size; ++arg_idx) {
+    auto const values = this->config_values_of(*config_tokens, config_indices.occurrences_of(arg_idx));
+    if (auto result = this->consume_fallback(map, arg_idx, values, ArgOrigin::CONFIG_FILE); !result) return result;
+  }
+  for (std::size_t arg_idx = 0; arg_idx < args_size; ++arg_idx) {
+    if (auto result = this->check_missing_arg(map, arg_idx); !result) return result;
+  }
+  return {};
+}
+
+ParseResult ParserCore::consume_from_tokens(
+  void *const map,
+  std::size_t const arg_idx,
+  std::span<Token const> const tokens,
+  TokenIndices const &indices,
+  std::size_t const tok_idx
+) {
+  this->desc->set_origin(map, arg_idx, ArgOrigin::CMD_LINE);
+  try {
+    switch (this->args[arg_idx].kind) {
+      case ArgKind::POS: return this->consume_or_defer(map, arg_idx, *tokens[tok_idx].value);
+      case ArgKind::FLG: {
+        this->desc->args[arg_idx].consume(map, this->cmd, indices.occurrences_of(arg_idx).size(), this->extra_info);
+        this->with_value[arg_idx] = true;
+        return this->check_exit_request();
+      }
+      case ArgKind::OPT: {
+        auto const arg_occurrences = indices.occurrences_of(arg_idx);
+        // TODO: make it vector of optionals to support implicit value
+        std::pmr::vector<std::string_view> opt_values(this->mem_resource);
+        opt_values.reserve(arg_occurrences.size());
+        for (auto const idx : arg_occurrences) {
+          // the scanner already took the value of `--option value` and `-O value`, so a missing one is really missing
+          if (!tokens[idx].value) {
+            auto cause = std::make_exception_ptr(MissingValue(*tokens[idx].name, 1, 0));
+            return this->fail(this->invalid_input(std::move(cause), arg_idx, idx));
+          }
+          opt_values.push_back(*tokens[idx].value);
+        }
+        return this->consume_or_defer(map, arg_idx, opt_values);
+      }
+    }
+  } catch (std::runtime_error const &) { // e.g. ConversionError
+    return this->fail(this->invalid_input(std::current_exception(), arg_idx, tok_idx));
+  }
+  return {};
+}
+
+// Keeps the values of an argument to be converted when first accessed, if conversion is lazy and the argument allows it
+std::expected<bool, ParseOutcome>
+ParserCore::defer_if_lazy(void *const map, std::size_t const arg_idx, std::span<std::string_view const> values) {
+  auto const &ops = this->desc->args[arg_idx];
+  if (!ops.is_deferrable || !this->lazy_conversion) return false;
+  // how many values there are doesn't depend on converting them, so too many is still an error when parsing
+  if (!ops.takes_many && values.size() > 1) {
+    auto cause = std::make_exception_ptr(UnexpectedValue(this->args[arg_idx].name, 1, values.size()));
+    return this->fail(this->invalid_input(std::move(cause), arg_idx));
+  }
+  this->desc->defer_conversion(map, arg_idx, values);
+  this->with_value[arg_idx] = true;
+  return true;
+}
+
+// Converting may throw, which the callers turn into an error of the argument
+ParseResult ParserCore::consume_or_defer(void *const map, std::size_t const arg_idx, std::string_view const value) {
+  auto const deferred = this->defer_if_lazy(map, arg_idx, std::span(&value, 1));
+  if (!deferred) return std::unexpected(deferred.error());
+  if (*deferred) return {};
+  this->desc->args[arg_idx].consume(map, this->cmd, value, this->extra_info);
+  this->with_value[arg_idx] = true;
+  return {};
+}
+
+ParseResult ParserCore::consume_or_defer(
+  void *const map, std::size_t const arg_idx, std::pmr::vector<std::string_view> const &values
+) {
+  auto const deferred = this->defer_if_lazy(map, arg_idx, values);
+  if (!deferred) return std::unexpected(deferred.error());
+  if (*deferred) return {};
+  this->desc->args[arg_idx].consume(map, this->cmd, std::cref(values), this->extra_info);
+  this->with_value[arg_idx] = true;
+  return {};
+}
+
+// +-----------------------+
+// |       fallbacks       |
+// +-----------------------+
+
+// Values of the environment variables bound to the arguments of this command, from a single pass over the environment
+std::pmr::vector<std::optional<std::string_view>> ParserCore::read_env_values() const {
+  std::pmr::vector<std::string_view> explicit_names(this->mem_resource);
+  explicit_names.reserve(this->args.size());
+  for (auto const &arg : this->args) {
+    explicit_names.push_back(arg.env);
+  }
+  std::pmr::vector<std::optional<std::string_view>> env_values(this->args.size(), this->mem_resource);
+  read_env(
+    EnvLookup{
+      .prefix = this->env_prefix,
+      .keys = this->desc->env_keys,
+      .seeds = this->desc->env_seeds,
+      .values = this->desc->env_values,
+      .explicit_names = explicit_names,
+    },
+    env_values,
+    this->mem_resource
+  );
+  return env_values;
+}
+
+std::pmr::vector<std::string_view> ParserCore::env_values_of(std::optional<std::string_view> const env_value) const {
+  std::pmr::vector<std::string_view> values(this->mem_resource);
+  if (env_value) values.push_back(*env_value);
+  return values;
+}
+
+// Entries of the config file that are in the section of this command, as tokens of the form `--key=value`, after a
+// token for the file itself (like the program name is for the command line)
+std::expected<std::pmr::vector<Token>, ParseOutcome> ParserCore::get_config_tokens() const {
+  std::pmr::vector<Token> config_tokens(this->mem_resource);
+  config_tokens.emplace_back(TokenKind::PROG_NAME, 0, std::nullopt, this->config.path);
+  if (this->config.entries.empty()) return config_tokens;
+
+  // path of this command, without the root command (whose entries are the ones before any section)
+  std::pmr::vector<std::string_view> cmd_path(this->mem_resource);
+  if (!this->extra_info.parent_cmds_names.empty()) {
+    cmd_path.assign(this->extra_info.parent_cmds_names.begin() + 1, this->extra_info.parent_cmds_names.end());
+    cmd_path.push_back(this->cmd_name);
+  }
+  auto const &lookup = this->desc->schema->lookup;
+  for (auto const &entry : this->config.entries) {
+    if (!is_section_of(entry.section, cmd_path)) continue;
+    auto const slot = lookup.find_name(entry.key);
+    if (slot == -1) {
+      auto const reason = fmt::format("unknown key `{}`", entry.key);
+      return this->fail(this->invalid_input(std::make_exception_ptr(ConfigFileError(this->config.path, entry.line, reason)))
+      );
+    }
+    config_tokens.emplace_back(
+      TokenKind::OPT_LONG_AND_VALUE, static_cast<std::uint32_t>(entry.line), entry.key, entry.value, slot
+    );
+  }
+  return config_tokens;
+}
+
+std::pmr::vector<std::string_view> ParserCore::config_values_of(
+  std::span<Token const> const config_tokens, std::span<std::size_t const> const occurrences
+) const {
+  std::pmr::vector<std::string_view> values(this->mem_resource);
+  values.reserve(occurrences.size());
+  for (auto const idx : occurrences) {
+    values.push_back(*config_tokens[idx].value);
+  }
+  return values;
+}
+
+// Consumes the values that the environment or the config file have for an argument that is still missing. Options
+// take all of them while positionals take the last one. Flags are set by a true-ish value as if given once, while a
+// false-ish one keeps the default value, so that it also overrides the layers after it.
+// Groups are checked as for the command line: a fallback value counts as its group being present, and two members of a
+// mutually exclusive group conflict if they get values from the same layer. A member that already has a value from a
+// layer with precedence wins over the others, which are left missing.
+ParseResult ParserCore::consume_fallback(
+  void *const map,
+  std::size_t const arg_idx,
+  std::pmr::vector<std::string_view> const &values,
+  ArgOrigin const origin
+) {
+  auto const &arg = this->args[arg_idx];
+  if (values.empty() || this->with_value[arg_idx]) return {};
+  if (arg.grp_kind == GroupKind::MUTUALLY_EXCLUSIVE) {
+    if (auto const grp_it = this->parsed_group_members.find(arg.grp_id); grp_it != this->parsed_group_members.end()) {
+      if (grp_it->second.origin != origin) return {};
+      return this->fail(this->conflict(arg_idx, arg.name, grp_it->second.id));
+    }
+  }
+  bool is_present = true;
+  try {
+    switch (arg.kind) {
+      case ArgKind::POS: {
+        if (auto result = this->consume_or_defer(map, arg_idx, values.back()); !result) return result;
+        break;
+      }
+      case ArgKind::FLG: {
+        if (!convert<bool>(values.back())) {
+          if (!arg.has_default) return {};
+          // the flag is left as if it wasn't given at all, so it doesn't count for its group
+          this->desc->args[arg_idx].set_default(map, this->cmd);
+          is_present = false;
+        } else {
+          this->desc->args[arg_idx].consume(map, this->cmd, std::size_t{1}, this->extra_info);
+        }
+        this->with_value[arg_idx] = true;
+        if (auto result = this->check_exit_request(); !result) return result;
+        break;
+      }
+      case ArgKind::OPT: {
+        if (auto result = this->consume_or_defer(map, arg_idx, values); !result) return result;
+        break;
+      }
+    }
+  } catch (std::runtime_error const &) {
+    return this->fail(this->invalid_input(std::current_exception(), arg_idx));
+  }
+  this->desc->set_origin(map, arg_idx, origin);
+  if (is_present && arg.has_group()) this->parsed_group_members.try_emplace(arg.grp_id, arg.name, origin);
+  return {};
+}
+
+// +-----------------------+
+// |        checks         |
+// +-----------------------+
+
+ParseResult ParserCore::post_process_arg(
+  std::size_t const arg_idx,
+  std::span<Token const> const tokens,
+  TokenIndices const &indices,
+  std::size_t &cur_pos_idx
+) {
+  auto const &arg = this->args[arg_idx];
+  if (this->with_value[arg_idx]) {
+    // get index of arg in tokens (we know it exists because it's present in args_map)
+    auto const tok_idx =
+      arg.kind == ArgKind::POS ? *indices.nth_pos_idx(cur_pos_idx) : indices.occurrences_of(arg_idx).front();
+
+    // check if we already have parsed an argument of the same group
+    if (arg.grp_kind == GroupKind::MUTUALLY_EXCLUSIVE) {
+      if (auto const grp_it = this->parsed_group_members.find(arg.grp_id); grp_it != this->parsed_group_members.end()) {
+        auto error = this->conflict(arg_idx, tokens[tok_idx].get_id(), grp_it->second.id);
+        error.tok_idx = tok_idx;
+        return this->fail(std::move(error));
+      }
+    }
+
+    // if not, register we now have
+    if (arg.has_group()) {
+      this->parsed_group_members[arg.grp_id] = GroupMember{tokens[tok_idx].get_id(), ArgOrigin::CMD_LINE};
+    }
+  }
+  cur_pos_idx += static_cast<std::size_t>(arg.kind == ArgKind::POS);
+  return {};
+}
+
+ParseResult ParserCore::check_missing_arg(void *const map, std::size_t const arg_idx) {
+  auto const &arg = this->args[arg_idx];
+  if (this->with_value[arg_idx]) return {};
+  if (arg.is_required && !arg.has_group())
+    return this->fail(this->missing(ErrorKind::MISSING_REQUIRED_ARGUMENT, arg_idx));
+  if (arg.grp_kind == GroupKind::ALL_REQUIRED && this->parsed_group_members.contains(arg.grp_id))
+    return this->fail(this->missing(ErrorKind::MISSING_ALL_REQUIRED_GROUPED_ARGUMENTS, arg_idx));
+  if (arg.grp_kind == GroupKind::MUTUALLY_EXCLUSIVE && !this->parsed_group_members.contains(arg.grp_id))
+    return this->fail(this->missing(ErrorKind::MISSING_MUTUALLY_EXCLUSIVE_GROUPED_ARGUMENTS, arg_idx));
+  if (arg.has_default) {
+    this->desc->args[arg_idx].set_default(map, this->cmd);
+    this->desc->set_origin(map, arg_idx, ArgOrigin::DEFAULT);
+    this->with_value[arg_idx] = true;
+  }
+  return {};
+}
+
+ParseResult ParserCore::check_unknown_args(
+  std::span<std::string_view const> const args,
+  std::span<Token const> const tokens,
+  TokenBitset const &consumed_indices
+) const {
+  if (consumed_indices.all()) return {};
+  ParseError error{.kind = ErrorKind::UNKNOWN_ARGUMENTS, .cmd_name = this->cmd_name};
+  std::optional<std::uint32_t> prev_args_idx;
+  consumed_indices.for_each_missing([&error, &prev_args_idx, args, tokens](std::size_t const idx) {
+    // several unknown flags may come from the same argument, like `-xyz`
+    if (tokens[idx].args_idx == prev_args_idx) return;
+    prev_args_idx = tokens[idx].args_idx;
+    if (error.tok_idx == no_index) error.tok_idx = idx;
+    else error.input.append("`, `");
+    error.input.append(args[tokens[idx].args_idx]);
+  });
+  return this->fail(std::move(error));
+}
+
+// +-----------------------+
+// |       outcomes        |
+// +-----------------------+
+
+std::unexpected<ParseOutcome> ParserCore::fail(ParseError error) const {
+  return std::unexpected(
+    ParseOutcome{.kind = OutcomeKind::USER_ERROR, .error = std::move(error), .formatter = this->get_cmd_fmt()}
+  );
+}
+
+ParseResult ParserCore::check_exit_request() const {
+  if (!this->extra_info.exit_request) return {};
+  return std::unexpected(
+    ParseOutcome{.kind = *this->extra_info.exit_request, .error = {}, .formatter = this->get_cmd_fmt()}
+  );
+}
+
+// The error whose cause is `cause`, one of the runtime errors that are reported as user errors
+ParseError ParserCore::invalid_input(
+  std::exception_ptr cause, std::size_t const arg_idx, std::size_t const tok_idx
+) const {
+  return ParseError{
+    .kind = ErrorKind::INVALID_INPUT,
+    .cmd_name = this->cmd_name,
+    .arg_idx = arg_idx,
+    .tok_idx = tok_idx,
+    .arg_name = arg_idx == no_index ? std::string_view{} : this->args[arg_idx].name,
+    .cause = std::move(cause),
+  };
+}
+
+ParseError ParserCore::missing(ErrorKind const kind, std::size_t const arg_idx) const {
+  return ParseError{
+    .kind = kind, .cmd_name = this->cmd_name, .arg_idx = arg_idx, .arg_name = this->args[arg_idx].name
+  };
+}
+
+ParseError
+ParserCore::conflict(std::size_t const arg_idx, std::string_view const id, std::string_view const other_id) const {
+  return ParseError{
+    .kind = ErrorKind::CONFLICTING_ARGUMENTS,
+    .cmd_name = this->cmd_name,
+    .arg_idx = arg_idx,
+    .arg_name = this->args[arg_idx].name,
+    .input = std::string(id),
+    .other_input = std::string(other_id),
+  };
+}
+
+} // namespace opz
@@ -0,0 +1,118 @@
+#include "opzioni/response_file.hpp"
+#include "opzioni/exceptions.hpp"
+#include "opzioni/strings.hpp"
+
+#include <cerrno>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace opz {
+
+// +--------------------------------+
+// |           MappedFile           |
+// +--------------------------------+
+
+MappedFile::MappedFile(char const *path) {
+  int const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) throw FileError(path, errno);
+  struct stat file_stat{};
+  if (::fstat(fd, &file_stat) == -1) {
+    auto const error = errno;
+    ::close(fd);
+    throw FileError(path, error);
+  }
+  // mapping an empty file is an error, but there is nothing to map anyway
+  if (file_stat.st_size > 0) {
+    auto const size = static_cast<std::size_t>(file_stat.st_size);
+    void *const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      auto const error = errno;
+      ::close(fd);
+      throw FileError(path, error);
+    }
+    this->data = data;
+    this->size = size;
+  }
+  ::close(fd); // the mapping stays valid after closing the file
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+  : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    if (this->data != nullptr) ::munmap(this->data, this->size);
+    this->data = std::exchange(other.data, nullptr);
+    this->size = std::exchange(other.size, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (this->data != nullptr) ::munmap(this->data, this->size);
+}
+
+[[nodiscard]] std::string_view MappedFile::contents() const noexcept {
+  return {static_cast<char const *>(this->data), this->size};
+}
+
+// +--------------------------------+
+// |         response files         |
+// +--------------------------------+
+
+static void split_on_nul(std::string_view contents, std::pmr::vector<std::string_view> &into) {
+  while (!contents.empty()) {
+    auto const end = std::min(contents.find('\0'), contents.size());
+    into.push_back(contents.substr(0, end));
+    contents.remove_prefix(std::min(end + 1, contents.size()));
+  }
+}
+
+static void split_on_whitespace(
+  std::string_view const path, std::string_view contents, std::pmr::vector<std::string_view> &into
+) {
+  while (true) {
+    contents.remove_prefix(std::min(contents.find_first_not_of(whitespace), contents.size()));
+    if (contents.empty()) return;
+    if (auto const quote = contents.front(); quote == '"' || quote == '\'') {
+      auto const end = contents.find(quote, 1);
+      if (end == std::string_view::npos) throw ResponseFileError(path, "unterminated quote");
+      into.push_back(contents.substr(1, end - 1));
+      contents.remove_prefix(end + 1);
+    } else {
+      auto const end = std::min(contents.find_first_of(whitespace), contents.size());
+      into.push_back(contents.substr(0, end));
+      contents.remove_prefix(end);
+    }
+  }
+}
+
+void expand_response_file(
+  std::string_view const path,
+  ResponseFileConfig const &config,
+  std::pmr::vector<std::string_view> &args,
+  std::pmr::vector<MappedFile> &files,
+  std::size_t const depth
+) {
+  auto *const mem_resource = args.get_allocator().resource();
+  if (depth > config.max_depth)
+    throw ResponseFileError(path, fmt::format("response files nested more than {} levels deep", config.max_depth));
+
+  // `path` may be a view into another mapping, which is not NUL-terminated
+  auto const &file = files.emplace_back(std::pmr::string(path, mem_resource).c_str());
+  std::pmr::vector<std::string_view> file_args(mem_resource);
+  if (config.nul_separated) split_on_nul(file.contents(), file_args);
+  else split_on_whitespace(path, file.contents(), file_args);
+
+  for (auto const arg : file_args) {
+    if (arg.size() > 1 && arg.front() == '@') expand_response_file(arg.substr(1), config, args, files, depth + 1);
+    else args.push_back(arg);
+  }
+}
+
+} // namespace opz
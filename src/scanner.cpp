@@ -1,4 +1,7 @@
 #include "opzioni/scanner.hpp"
+#include "opzioni/simd.hpp"
+
+#include <utility>
 
 namespace opz {
 
@@ -11,30 +14,52 @@ std::string_view to_string(TokenKind const kind) noexcept {
     case TokenKind::OPT_LONG_AND_VALUE: return "OPT_LONG_AND_VALUE";
     case TokenKind::OPT_SHORT_AND_VALUE: return "OPT_SHORT_AND_VALUE";
     case TokenKind::IDENTIFIER: return "IDENTIFIER";
+    case TokenKind::SUBCMD: return "SUBCMD";
     default: return "ERR";
   }
 }
 
-TokenIndices index_tokens(std::span<Token const> const tokens) {
-  auto indices = TokenIndices();
-  if (!tokens.empty()) { // should never happen
-    for (std::size_t index = 1; index < tokens.size(); ++index) {
-      switch (auto const &tok = tokens[index]; tok.kind) {
-        case TokenKind::PROG_NAME: break;
-        case TokenKind::DASH_DASH:
-          // +1 to ignore the dash-dash
-          for (std::size_t offset = index + 1; offset < tokens.size(); ++offset) {
-            indices.positionals.push_back(offset);
-          }
-          index = tokens.size(); // break below refers to the switch, not the for loop
-          break;
-        case TokenKind::FLG: [[fallthrough]];
-        case TokenKind::OPT_OR_FLG_LONG: [[fallthrough]];
-        case TokenKind::OPT_LONG_AND_VALUE: [[fallthrough]];
-        case TokenKind::OPT_SHORT_AND_VALUE: indices.opts_n_flgs[*tok.name].push_back(index); break;
-        case TokenKind::IDENTIFIER: indices.positionals.push_back(index); break;
-      }
-    }
+// Index of the argument that a token refers to, `positional` if it is a positional, or -1 if it is unknown
+static int arg_idx_of(Token const &tok, int const positional) noexcept {
+  switch (tok.kind) {
+    case TokenKind::FLG: [[fallthrough]];
+    case TokenKind::OPT_SHORT_AND_VALUE: [[fallthrough]];
+    case TokenKind::OPT_OR_FLG_LONG: [[fallthrough]];
+    case TokenKind::OPT_LONG_AND_VALUE: return tok.slot;
+    case TokenKind::IDENTIFIER: return positional;
+    case TokenKind::PROG_NAME: [[fallthrough]];
+    case TokenKind::DASH_DASH: [[fallthrough]];
+    case TokenKind::SUBCMD: [[fallthrough]];
+    default: return -1;
+  }
+}
+
+TokenIndices index_tokens(
+  std::span<Token const> const tokens,
+  std::size_t const args_count,
+  std::size_t const first,
+  std::size_t const last,
+  std::pmr::memory_resource *const mem_resource
+) {
+  // `first` is the token of the command itself, so its arguments are in (first, last]
+  auto const positional = static_cast<int>(args_count);
+  auto indices = TokenIndices(args_count, last - first, mem_resource);
+  auto &offsets = indices.storage;
+
+  // first pass: count how many occurrences each argument has
+  for (auto index = first + 1; index <= last; ++index) {
+    if (auto const arg_idx = arg_idx_of(tokens[index], positional); arg_idx != -1) offsets[arg_idx] += 1;
+  }
+  // turn counts into the end offset of each argument
+  for (std::size_t arg_idx = 1; arg_idx <= args_count + 1; ++arg_idx) {
+    offsets[arg_idx] += offsets[arg_idx - 1];
+  }
+
+  // second pass, backwards: fill in occurrences from each end offset, which leaves offsets pointing to the beginning
+  auto const occurrences = std::span(offsets).subspan(args_count + 2);
+  for (auto index = last; index > first; --index) {
+    if (auto const arg_idx = arg_idx_of(tokens[index], positional); arg_idx != -1)
+      occurrences[--offsets[arg_idx]] = index;
   }
   return indices;
 }
@@ -45,12 +70,50 @@ TokenIndices index_tokens(std::span<Token const> const tokens) {
 
 /* public */
 
-std::vector<Token> Scanner::operator()() noexcept {
-  this->add_token(TokenKind::PROG_NAME, std::nullopt, this->cur_arg());
-  for (this->args_idx = 1; this->args_idx < this->args.size(); ++this->args_idx) {
-    this->cur_col = 0;
-    this->scan_token();
+Scanner::Scanner(std::pmr::memory_resource *const mem_resource) noexcept
+  : args(mem_resource), response_files(mem_resource), tokens(mem_resource) {}
+
+Scanner::Scanner(
+  std::span<char const *> const args,
+  CmdRef const root,
+  std::optional<ResponseFileConfig> const &response_files,
+  std::pmr::memory_resource *const mem_resource
+)
+  : Scanner(mem_resource) {
+  this->reset(args, root, response_files);
+}
+
+void Scanner::reset(
+  std::span<char const *> const args, CmdRef const root, std::optional<ResponseFileConfig> const &response_files
+) {
+  this->args.clear();
+  this->response_files.clear();
+  this->tokens.clear();
+  this->cur_cmd = root;
+  this->args_idx = 0;
+  this->cur_col = 0;
+  this->after_dash_dash = false;
+
+  // The length of each argument is found with a `strlen` (which libc vectorizes) rather than from the distance to the
+  // next one, even though the kernel lays `argv` out back to back: telling whether they are would mean reading the
+  // bytes between arguments that turn out not to be, which belong to no argument
+  this->args.reserve(args.size());
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    std::string_view const arg = args[i];
+    if (response_files && i > 0 && arg.size() > 1 && arg.front() == '@')
+      expand_response_file(arg.substr(1), *response_files, this->args, this->response_files);
+    else this->args.push_back(arg);
   }
+  this->tokens.reserve(this->args.size());
+}
+
+void Scanner::push(std::string_view const arg) noexcept {
+  this->args.push_back(arg);
+  this->scan_pending(false);
+}
+
+std::span<Token const> Scanner::operator()() noexcept {
+  this->scan_pending(true);
   return this->tokens;
 }
 
@@ -69,67 +132,98 @@ std::vector<Token> Scanner::operator()() noexcept {
 
 void Scanner::consume() noexcept { this->cur_col += 1; }
 
-[[nodiscard]] bool Scanner::match(char const expected) noexcept {
-  // if (this->is_cur_end()) return false;
-  // if (this->cur_arg()[this->current_col] != expected) return false;
-  if (this->peek() != expected) return false;
-  this->cur_col += 1;
-  return true;
+// The next argument, if it can be the value of an option given as `--option value` or `-O value`
+[[nodiscard]] std::optional<std::string_view> Scanner::peek_next_value() const noexcept {
+  if (this->args_idx + 1 >= this->args.size()) return std::nullopt;
+  auto const next = this->args[this->args_idx + 1];
+  if (!next.empty() && next.front() == dash && next.size() > 1) return std::nullopt;
+  return next;
 }
 
 void Scanner::add_token(
-  TokenKind kind, std::optional<std::string_view> name, std::optional<std::string_view> value
+  TokenKind kind, std::optional<std::string_view> name, std::optional<std::string_view> value, int const slot
 ) noexcept {
-  this->tokens.emplace_back(kind, this->args_idx, name, value);
+  this->tokens.emplace_back(kind, this->args_idx, name, value, slot);
 }
 
-void Scanner::scan_token() noexcept {
-  if (!this->match(dash)) {
-    this->add_token(TokenKind::IDENTIFIER, std::nullopt, this->cur_arg());
+// Adds an option or flag whose value, if any, is the next argument
+void Scanner::add_opt_token(TokenKind const kind, std::string_view const name, int const slot) noexcept {
+  if (!this->cur_cmd.schema->takes_value(slot)) {
+    this->add_token(kind, name, std::nullopt, slot);
     return;
   }
+  auto const value = this->peek_next_value();
+  this->add_token(kind, name, value, slot);
+  if (value) this->args_idx += 1; // so that the value isn't scanned as an argument of its own
+}
 
-  if (this->is_cur_end()) this->add_token(TokenKind::IDENTIFIER, std::nullopt, this->cur_arg());
-  else if (this->match(dash)) {
-    if (this->is_cur_end()) this->add_token(TokenKind::DASH_DASH);
-    else this->long_opt();
-  } else this->short_opt();
+void Scanner::scan_pending(bool const is_final) noexcept {
+  for (; this->args_idx < this->args.size() && (is_final || this->args_idx + 1 < this->args.size()); ++this->args_idx) {
+    this->cur_col = 0;
+    if (this->args_idx == 0) this->add_token(TokenKind::PROG_NAME, std::nullopt, this->cur_arg());
+    else this->scan_token();
+  }
+}
+
+void Scanner::scan_token() noexcept {
+  // classified by its first two bytes: `-` or a word is an identifier, `--` alone ends options, and otherwise `--` starts
+  // a long option and `-` one or more short ones
+  auto const arg = this->cur_arg();
+  if (this->after_dash_dash || arg.size() < 2 || arg[0] != dash) {
+    this->identifier();
+  } else if (arg[1] != dash) {
+    this->cur_col = 1;
+    this->short_opt();
+  } else if (arg.size() == 2) {
+    this->add_token(TokenKind::DASH_DASH);
+    this->after_dash_dash = true;
+  } else {
+    this->cur_col = 2;
+    this->long_opt();
+  }
+}
+
+void Scanner::identifier() noexcept {
+  // commands with subcommands can't have positionals, so any identifier may only be a subcommand
+  auto const &schema = *this->cur_cmd.schema;
+  if (auto const subcmd_idx = schema.find_subcmd(this->cur_cmd.cmd, this->cur_arg()); subcmd_idx != -1) {
+    this->add_token(TokenKind::SUBCMD, std::nullopt, this->cur_arg(), subcmd_idx);
+    this->cur_cmd = schema.get_subcmd(this->cur_cmd.cmd, subcmd_idx);
+  } else {
+    this->add_token(TokenKind::IDENTIFIER, std::nullopt, this->cur_arg());
+  }
 }
 
 void Scanner::long_opt() noexcept {
   // -- was already consumed
   // look for either: name=value or name
-  while (!this->is_cur_end() && this->peek() != '=')
-    consume();
-  if (this->match('=')) {
-    // start at 2 to discard initial dash-dash; -3 would be -1 but adds 2 because we start at 2
-    auto const name = this->cur_arg().substr(2, this->cur_col - 3);
-    auto const value = this->cur_arg().substr(this->cur_col);
-    this->add_token(TokenKind::OPT_LONG_AND_VALUE, name, value);
+  // 16 bytes at a time, which for the usual short names is a byte at a time without the call to `memchr`
+  if (auto const eq_idx = find_any<'='>(this->cur_arg(), this->cur_col); eq_idx != this->cur_arg().size()) {
+    // start at 2 to discard initial dash-dash
+    auto const name = this->cur_arg().substr(2, eq_idx - 2);
+    auto const value = this->cur_arg().substr(eq_idx + 1);
+    this->add_token(TokenKind::OPT_LONG_AND_VALUE, name, value, this->cur_cmd.schema->lookup.find_name(name));
   } else {
-    this->add_token(TokenKind::OPT_OR_FLG_LONG, this->cur_arg().substr(2)); // 2 to discard initial dash-dash
+    auto const name = this->cur_arg().substr(2); // 2 to discard initial dash-dash
+    this->add_opt_token(TokenKind::OPT_OR_FLG_LONG, name, this->cur_cmd.schema->lookup.find_name(name));
   }
 }
 
 void Scanner::short_opt() noexcept {
   // - was already consumed
-  // look for either: -Ovalue or -O value or -f or -xpto
-  if (auto const c = this->peek(); c >= 'A' && c <= 'Z') {
-    auto const name = this->advance();
-    std::optional<std::string_view> value = std::nullopt;
-    if (this->cur_arg().length() > 2)
-      value.emplace(std::next(this->cur_arg().begin(), this->cur_col), this->cur_arg().end());
-    this->add_token(TokenKind::OPT_SHORT_AND_VALUE, name, value);
-    return;
-  }
-
-  if (this->cur_arg().length() == 2) {
-    this->add_token(TokenKind::FLG, this->advance());
-    return;
-  }
-
+  // look for either: -Ovalue or -O value or -f or -xpto (or -xpO value, -xpOvalue)
   while (!this->is_cur_end()) {
-    this->add_token(TokenKind::FLG, this->advance());
+    auto const name = this->advance();
+    auto const slot = this->cur_cmd.schema->lookup.find_abbrev(name.front());
+    if (!this->cur_cmd.schema->takes_value(slot)) {
+      this->add_token(TokenKind::FLG, name, std::nullopt, slot);
+    } else if (!this->is_cur_end()) {
+      this->add_token(TokenKind::OPT_SHORT_AND_VALUE, name, this->cur_arg().substr(this->cur_col), slot);
+      return;
+    } else {
+      this->add_opt_token(TokenKind::OPT_SHORT_AND_VALUE, name, slot);
+      return;
+    }
   }
 }
 
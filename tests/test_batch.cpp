@@ -0,0 +1,82 @@
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/batch.hpp"
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+constexpr auto cmd = new_cmd("prog").pos<"name">({}).opt<"num", "N", int>({}).flg<"help", "h">(default_help);
+
+constexpr auto lazy_cmd = new_cmd("prog").with({.lazy_conversion = true}).opt<"num", "N", int>({});
+
+// Lines that alternate between valid, a conversion error, help and a missing argument
+[[nodiscard]] std::string mixed_lines(std::size_t const amount) {
+  constexpr std::array<std::string_view, 4> kinds{"a -N 1\n", "a -N x\n", "--help\n", "-N 2\n"};
+  std::string lines;
+  for (std::size_t i = 0; i < amount; ++i) {
+    lines += kinds[i % kinds.size()];
+  }
+  return lines;
+}
+
+} // namespace
+
+TEST_CASE("each line of a batch gets its own result", "[batch]") {
+  auto const results = validate_batch(cmd, mixed_lines(4), {.threads = 1});
+  REQUIRE(results.size() == 4);
+  CHECK_FALSE(results[0].has_value());
+  REQUIRE(results[1].has_value());
+  CHECK_THAT(*results[1], Catch::Contains("`x`"));
+  CHECK_FALSE(results[2].has_value()); // asking for help is valid
+  REQUIRE(results[3].has_value());
+  CHECK_THAT(*results[3], Catch::Contains("Missing required argument `name`"));
+}
+
+TEST_CASE("a batch has the same results on any number of threads", "[batch][threads]") {
+  auto const lines = mixed_lines(1000);
+  auto const expected = validate_batch(cmd, lines, {.threads = 1});
+  for (unsigned const threads : {2u, 4u, 8u}) {
+    CHECK(validate_batch(cmd, lines, {.threads = threads, .chunk_size = 7}) == expected);
+  }
+}
+
+TEST_CASE("values whose conversion was deferred are converted when validating", "[batch]") {
+  std::array valid{"prog", "-N", "1"};
+  std::array invalid{"prog", "-N", "x"};
+  std::array<std::span<char const *>, 2> const argvs{valid, invalid};
+  auto const results = validate_batch(lazy_cmd, argvs, {.threads = 2, .chunk_size = 1});
+  CHECK_FALSE(results[0].has_value());
+  CHECK(results[1].has_value());
+}
+
+TEST_CASE("what a thread of a batch throws is rethrown on the calling thread", "[batch][threads]") {
+  auto const parse_ith = [](auto &parser, auto &map, std::size_t const i) {
+    if (i == 500) throw std::logic_error("line 500");
+    std::array argv{"prog", "a"};
+    return parser.try_parse_into(map, argv);
+  };
+  CHECK_THROWS_WITH(validate_batch(cmd, 1000, {.threads = 4, .chunk_size = 16}, parse_ith), "line 500");
+}
+
+TEST_CASE("a map with deferred conversions may be read from several threads once validated", "[batch][threads]") {
+  std::array argv{"prog", "-N", "42"};
+  auto const map = CmdParser(lazy_cmd)(argv);
+  map.validate_all();
+  std::vector<int> seen(4);
+  {
+    std::vector<std::jthread> readers;
+    for (auto &value : seen) {
+      readers.emplace_back([&map, &value] { value = map.get<"num">(); });
+    }
+  }
+  CHECK(seen == std::vector{42, 42, 42, 42});
+}
@@ -0,0 +1,40 @@
+#include <cstdint>
+#include <limits>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/converters.hpp"
+
+using namespace opz;
+
+TEST_CASE("plain decimal integers are converted", "[converters]") {
+  CHECK(try_convert<int>("-1234567") == -1234567);
+  CHECK(try_convert<unsigned>("42") == 42u);
+  CHECK(try_convert<std::int8_t>("-128") == std::int8_t{-128});
+}
+
+TEST_CASE("integers may have a plus and a base prefix after their sign", "[converters]") {
+  CHECK(try_convert<int>("+5") == 5);
+  CHECK(try_convert<int>("-0x10") == -16);
+  CHECK(try_convert<int>("0B101") == 5);
+  CHECK(try_convert<std::int64_t>("-0x8000000000000000") == std::numeric_limits<std::int64_t>::min());
+  CHECK(try_convert<unsigned>("+0xffffffff") == 0xffffffffu);
+  CHECK(try_convert<unsigned>("-0") == 0u);
+}
+
+TEST_CASE("integers out of the range of their type are rejected", "[converters]") {
+  CHECK(try_convert<std::int8_t>("-129").error() == ConversionErrc::out_of_range);
+  CHECK(try_convert<std::int8_t>("0x80").error() == ConversionErrc::out_of_range);
+  CHECK(try_convert<std::uint8_t>("+256").error() == ConversionErrc::out_of_range);
+  CHECK(try_convert<unsigned>("-1").error() == ConversionErrc::out_of_range);
+  CHECK(try_convert<std::uint64_t>("0x10000000000000000").error() == ConversionErrc::out_of_range);
+}
+
+TEST_CASE("integers must be consumed in full", "[converters]") {
+  CHECK(try_convert<int>("").error() == ConversionErrc::empty);
+  CHECK(try_convert<int>("12x").error() == ConversionErrc::invalid);
+  CHECK(try_convert<int>("0x").error() == ConversionErrc::invalid);
+  CHECK(try_convert<int>("+-1").error() == ConversionErrc::invalid);
+  CHECK(try_convert<int>("--1").error() == ConversionErrc::invalid);
+  CHECK(try_convert<int>("0x-1").error() == ConversionErrc::invalid);
+}
@@ -0,0 +1,69 @@
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+using strings = std::vector<std::string>;
+
+constexpr auto cmd = new_cmd("prog")
+                       .opt<"nums", "n", std::vector<int>, act::csv>({})
+                       .opt<"paths", "p", std::vector<std::string_view>, act::csv_with<':'>>({})
+                       .opt<"names", "N", strings, act::csv_with<';', '\\'>>({});
+
+} // namespace
+
+TEST_CASE("CSV values are split on their delimiter", "[csv]") {
+  std::array args{"prog", "-n", "1,2,3", "--paths=/bin:/usr/bin"};
+  auto const map = CmdParser(cmd)(args);
+  CHECK(map.get<"nums">() == std::vector{1, 2, 3});
+  CHECK(map.get<"paths">() == std::vector<std::string_view>{"/bin", "/usr/bin"});
+}
+
+TEST_CASE("CSV values keep their empty elements", "[csv]") {
+  std::vector<std::string_view> values;
+  convert_into<','>(values, ",a,,b,");
+  CHECK(values == std::vector<std::string_view>{"", "a", "", "b", ""});
+}
+
+TEST_CASE("an escaped delimiter is part of a CSV element", "[csv][escapes]") {
+  strings values;
+  convert_into<';', '\\'>(values, R"(a\;b;c)");
+  CHECK(values == strings{"a;b", "c"});
+}
+
+TEST_CASE("an escaped escape is a literal one and doesn't escape what follows it", "[csv][escapes]") {
+  strings values;
+  convert_into<';', '\\'>(values, R"(a\\;b)");
+  CHECK(values == strings{R"(a\)", "b"});
+}
+
+TEST_CASE("an escape escapes any character, not only delimiters", "[csv][escapes]") {
+  strings values;
+  convert_into<';', '\\'>(values, R"(\a\b;\c)");
+  CHECK(values == strings{"ab", "c"});
+}
+
+TEST_CASE("an escape at the very end of a CSV value is kept", "[csv][escapes]") {
+  strings values;
+  convert_into<';', '\\'>(values, R"(a;b\)");
+  CHECK(values == strings{"a", R"(b\)"});
+}
+
+TEST_CASE("several escapes in one CSV element are all unescaped", "[csv][escapes]") {
+  std::array args{"prog", "-N", R"(x\;y\;z;w)"};
+  auto const map = CmdParser(cmd)(args);
+  CHECK(map.get<"names">() == strings{"x;y;z", "w"});
+}
+
+TEST_CASE("each element of a CSV value is converted", "[csv]") {
+  std::array args{"prog", "-n", "1,x,3"};
+  CHECK_THROWS_WITH(CmdParser(cmd)(args), Catch::Contains("`x`"));
+}
@@ -0,0 +1,73 @@
+#include <array>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+constexpr auto cmd = new_cmd("prog")
+                       .pos<"name">({})
+                       .opt<"num", "N", int>({})
+                       .grp(
+                         new_grp(GroupKind::MUTUALLY_EXCLUSIVE)
+                           .opt<"left">({.is_required = true})
+                           .opt<"right">({.is_required = true})
+                       );
+
+} // namespace
+
+TEST_CASE("a missing required argument is reported by its index", "[errors]") {
+  std::array argv{"prog", "--left=1"};
+  try {
+    (void) CmdParser(cmd)(argv);
+    FAIL("parsing did not throw");
+  } catch (MissingRequiredArgument const &e) {
+    CHECK(e.error.kind == ErrorKind::MISSING_REQUIRED_ARGUMENT);
+    CHECK(e.error.arg_idx == 0);
+    CHECK(e.error.arg_name == "name");
+    CHECK(std::string(e.what()) == "Missing required argument `name` for command `prog`");
+  }
+}
+
+TEST_CASE("unknown arguments are reported by the index of the first one", "[errors]") {
+  std::array argv{"prog", "x", "--left=1", "--nope", "-z"};
+  try {
+    (void) CmdParser(cmd)(argv);
+    FAIL("parsing did not throw");
+  } catch (UnknownArguments const &e) {
+    CHECK(e.error.kind == ErrorKind::UNKNOWN_ARGUMENTS);
+    CHECK(e.error.tok_idx == 3);
+    CHECK(std::string(e.what()) == "Unknown arguments for `prog` command: `--nope`, `-z`");
+  }
+}
+
+TEST_CASE("conflicting arguments are reported by the index of the second one", "[errors]") {
+  std::array argv{"prog", "x", "--left=1", "--right=2"};
+  try {
+    (void) CmdParser(cmd)(argv);
+    FAIL("parsing did not throw");
+  } catch (ConflictingArguments const &e) {
+    CHECK(e.error.arg_idx == 3);
+    CHECK(e.error.tok_idx == 3);
+    CHECK(e.error.input == "right");
+    CHECK(e.error.other_input == "left");
+  }
+}
+
+TEST_CASE("a value that can't be converted keeps the conversion error as its cause", "[errors]") {
+  std::array argv{"prog", "x", "--num=abc", "--left=1"};
+  try {
+    (void) CmdParser(cmd)(argv);
+    FAIL("parsing did not throw");
+  } catch (UserError const &e) {
+    CHECK(e.error.kind == ErrorKind::INVALID_INPUT);
+    CHECK(e.error.arg_idx == 1);
+    CHECK(e.error.tok_idx == 2);
+    CHECK_THROWS_AS(std::rethrow_exception(e.error.cause), ConversionError);
+    CHECK_THAT(e.what(), Catch::Contains("abc"));
+  }
+}
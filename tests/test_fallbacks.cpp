@@ -0,0 +1,128 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+// Sets an environment variable for as long as it is alive
+class EnvVar {
+public:
+
+  EnvVar(char const *name, char const *value) : name(name) { setenv(name, value, 1); }
+  ~EnvVar() { unsetenv(this->name); }
+
+  EnvVar(EnvVar const &) = delete;
+  EnvVar &operator=(EnvVar const &) = delete;
+
+private:
+
+  char const *name;
+};
+
+// A config file with `contents`, which is removed when it goes out of scope
+class TempConfig {
+public:
+
+  explicit TempConfig(std::string_view const contents) : path(std::string(std::tmpnam(nullptr)) + ".conf") {
+    auto *const file = std::fopen(this->path.c_str(), "w");
+    std::fwrite(contents.data(), 1, contents.size(), file);
+    std::fclose(file);
+  }
+  ~TempConfig() { std::remove(this->path.c_str()); }
+
+  TempConfig(TempConfig const &) = delete;
+  TempConfig &operator=(TempConfig const &) = delete;
+
+  [[nodiscard]] ConfigFile config() const noexcept { return ConfigFile{.path = this->path.c_str()}; }
+
+private:
+
+  std::string path;
+};
+
+constexpr auto exclusive_cmd = new_cmd("prog").with({.env_prefix = "OPZ_TEST_"}).grp(
+  new_grp(GroupKind::MUTUALLY_EXCLUSIVE).opt<"alpha">({.is_required = true}).opt<"beta">({.is_required = true})
+);
+
+constexpr auto all_required_cmd =
+  new_cmd("prog").with({.env_prefix = "OPZ_TEST_"}).grp(new_grp().opt<"alpha">({}).opt<"beta">({}));
+
+} // namespace
+
+TEST_CASE("a mutually exclusive member from the environment satisfies its group", "[fallbacks][env][groups]") {
+  EnvVar const alpha("OPZ_TEST_ALPHA", "a");
+  std::array args{"prog"};
+  auto const map = CmdParser(exclusive_cmd)(args);
+  CHECK(map.get<"alpha">() == "a");
+  CHECK(map.origin_of<"alpha">() == ArgOrigin::ENV);
+  CHECK(map.origin_of<"beta">() == ArgOrigin::DEFAULT);
+}
+
+TEST_CASE("two mutually exclusive members from the environment conflict", "[fallbacks][env][groups]") {
+  EnvVar const alpha("OPZ_TEST_ALPHA", "a");
+  EnvVar const beta("OPZ_TEST_BETA", "b");
+  std::array args{"prog"};
+  CHECK_THROWS_WITH(CmdParser(exclusive_cmd)(args), Catch::Contains("`beta` and `alpha`"));
+}
+
+TEST_CASE("the command line wins over the environment in a mutually exclusive group", "[fallbacks][env][groups]") {
+  EnvVar const alpha("OPZ_TEST_ALPHA", "a");
+  std::array args{"prog", "--beta=b"};
+  auto const map = CmdParser(exclusive_cmd)(args);
+  CHECK(map.get<"beta">() == "b");
+  CHECK(map.origin_of<"alpha">() == ArgOrigin::DEFAULT);
+}
+
+TEST_CASE("an all-required group only partly in the environment is missing the rest", "[fallbacks][env][groups]") {
+  EnvVar const alpha("OPZ_TEST_ALPHA", "a");
+  std::array args{"prog"};
+  CHECK_THROWS_WITH(CmdParser(all_required_cmd)(args), Catch::Contains("Argument `beta`") && Catch::Contains("all"));
+}
+
+TEST_CASE("an all-required group may be completed from the environment", "[fallbacks][env][groups]") {
+  EnvVar const beta("OPZ_TEST_BETA", "b");
+  std::array args{"prog", "--alpha=a"};
+  auto const map = CmdParser(all_required_cmd)(args);
+  CHECK(map.get<"alpha">() == "a");
+  CHECK(map.get<"beta">() == "b");
+}
+
+TEST_CASE("a mutually exclusive member from the config file satisfies its group", "[fallbacks][config][groups]") {
+  TempConfig const file("alpha = a\n");
+  std::array args{"prog"};
+  auto const map = CmdParser(exclusive_cmd)(args, file.config());
+  CHECK(map.get<"alpha">() == "a");
+  CHECK(map.origin_of<"alpha">() == ArgOrigin::CONFIG_FILE);
+  CHECK(map.origin_of<"beta">() == ArgOrigin::DEFAULT);
+}
+
+TEST_CASE("two mutually exclusive members from the config file conflict", "[fallbacks][config][groups]") {
+  TempConfig const file("alpha = a\nbeta = b\n");
+  std::array args{"prog"};
+  CHECK_THROWS_WITH(CmdParser(exclusive_cmd)(args, file.config()), Catch::Contains("`beta` and `alpha`"));
+}
+
+TEST_CASE("the environment wins over the config file in a mutually exclusive group", "[fallbacks][config][groups]") {
+  EnvVar const beta("OPZ_TEST_BETA", "b");
+  TempConfig const file("alpha = a\n");
+  std::array args{"prog"};
+  auto const map = CmdParser(exclusive_cmd)(args, file.config());
+  CHECK(map.get<"beta">() == "b");
+  CHECK(map.origin_of<"alpha">() == ArgOrigin::DEFAULT);
+}
+
+TEST_CASE("an all-required group only partly in the config file is missing the rest", "[fallbacks][config][groups]") {
+  TempConfig const file("alpha = a\n");
+  std::array args{"prog"};
+  CHECK_THROWS_WITH(
+    CmdParser(all_required_cmd)(args, file.config()), Catch::Contains("Argument `beta`") && Catch::Contains("all")
+  );
+}
@@ -0,0 +1,79 @@
+#include <array>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+constexpr auto sub = new_cmd("sub").pos<"file">({}).flg<"help", "h">(default_help);
+
+constexpr auto cmd = new_cmd("prog", "1.2.3")
+                       .opt<"num", "N", int>({})
+                       .flg<"help", "h">(default_help)
+                       .flg<"version", "V">(default_version)
+                       .sub(sub);
+
+} // namespace
+
+TEST_CASE("try_parse returns the map of a valid command line", "[outcomes]") {
+  std::array argv{"prog", "--num=3", "sub", "a.txt"};
+  auto const map = cmd.try_parse(argv);
+  REQUIRE(map.has_value());
+  CHECK(map->get<"num">() == 3);
+  CHECK(map->has_submap());
+}
+
+TEST_CASE("try_parse returns asking for help as its outcome", "[outcomes]") {
+  std::array argv{"prog", "--help"};
+  auto const map = cmd.try_parse(argv);
+  REQUIRE_FALSE(map.has_value());
+  CHECK(map.error().kind == OutcomeKind::HELP);
+  CHECK_FALSE(map.error().is_error());
+  CHECK(map.error().formatter.get().name == "prog");
+}
+
+TEST_CASE("try_parse returns asking for help in a subcommand with the subcommand", "[outcomes]") {
+  std::array argv{"prog", "sub", "-h"};
+  auto const map = cmd.try_parse(argv);
+  REQUIRE_FALSE(map.has_value());
+  CHECK(map.error().kind == OutcomeKind::HELP);
+  auto const cmd_fmt = map.error().formatter.get();
+  CHECK(cmd_fmt.name == "sub");
+  REQUIRE(cmd_fmt.parent_cmds_names.size() == 1);
+  CHECK(cmd_fmt.parent_cmds_names.front() == "prog");
+}
+
+TEST_CASE("try_parse returns asking for the version as its outcome", "[outcomes]") {
+  std::array argv{"prog", "-V"};
+  auto const map = cmd.try_parse(argv);
+  REQUIRE_FALSE(map.has_value());
+  CHECK(map.error().kind == OutcomeKind::VERSION);
+}
+
+TEST_CASE("try_parse returns errors of the user as its outcome", "[outcomes]") {
+  std::array argv{"prog", "--num=x"};
+  auto const map = cmd.try_parse(argv);
+  REQUIRE_FALSE(map.has_value());
+  CHECK(map.error().is_error());
+  CHECK(map.error().error.kind == ErrorKind::INVALID_INPUT);
+  CHECK(map.error().error.arg_name == "num");
+  CHECK_THAT(map.error().message(), Catch::Contains("`x`"));
+}
+
+TEST_CASE("try_parse_into of a reusable parser starts over after an outcome", "[outcomes]") {
+  auto parser = cmd.reusable_parser();
+  auto map = parser.new_map();
+  std::array help{"prog", "--help"};
+  CHECK_FALSE(parser.try_parse_into(map, help).has_value());
+  std::array valid{"prog", "-N", "5"};
+  REQUIRE(parser.try_parse_into(map, valid).has_value());
+  CHECK(map.get<"num">() == 5);
+}
+
+TEST_CASE("the throwing parser throws the error that try_parse returns", "[outcomes]") {
+  std::array argv{"prog", "sub"};
+  CHECK_THROWS_AS(CmdParser(cmd)(argv), MissingRequiredArgument);
+}
@@ -0,0 +1,78 @@
+#include <array>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+// A response file with `contents`, which is removed when it goes out of scope
+class TempFile {
+public:
+
+  explicit TempFile(std::string_view const contents) : path(std::tmpnam(nullptr)), arg('@' + path) {
+    auto *const file = std::fopen(this->path.c_str(), "w");
+    std::fwrite(contents.data(), 1, contents.size(), file);
+    std::fclose(file);
+  }
+  ~TempFile() { std::remove(this->path.c_str()); }
+
+  TempFile(TempFile const &) = delete;
+  TempFile &operator=(TempFile const &) = delete;
+
+  // `@path`, as the file is referred to in the command line or in another response file
+  [[nodiscard]] char const *at_path() const noexcept { return this->arg.c_str(); }
+
+private:
+
+  std::string path;
+  std::string arg;
+};
+
+constexpr auto cmd = new_cmd("prog")
+                       .with({.response_files = ResponseFileConfig{.max_depth = 2}})
+                       .pos<"name">({})
+                       .opt<"num", "N", int>({})
+                       .opt<"tag", "t", std::vector<std::string_view>, act::append>({});
+
+} // namespace
+
+TEST_CASE("a response file is expanded in place of its argument", "[response_files]") {
+  TempFile const file("--num 3\n-t 'a b' -t \"c\"\n");
+  std::array args{"prog", "-t", "first", file.at_path(), "name"};
+  auto const map = CmdParser(cmd)(args);
+  CHECK(map.get<"num">() == 3);
+  CHECK(map.get<"tag">() == std::vector<std::string_view>{"first", "a b", "c"});
+  CHECK(map.get<"name">() == "name");
+}
+
+TEST_CASE("response files may refer to others up to the maximum depth", "[response_files]") {
+  TempFile const inner("--num 3");
+  TempFile const outer(std::string("name ") + inner.at_path());
+  std::array args{"prog", outer.at_path()};
+  auto const map = CmdParser(cmd)(args);
+  CHECK(map.get<"num">() == 3);
+  CHECK(map.get<"name">() == "name");
+}
+
+TEST_CASE("response files nested deeper than the maximum depth are an error", "[response_files]") {
+  TempFile const innermost("--num 3");
+  TempFile const inner(innermost.at_path());
+  TempFile const outer(std::string("name ") + inner.at_path());
+  std::array args{"prog", outer.at_path()};
+  auto const map = CmdParser(cmd).try_parse(args);
+  REQUIRE_FALSE(map.has_value());
+  CHECK(map.error().error.kind == ErrorKind::INVALID_INPUT);
+  CHECK_THAT(map.error().message(), Catch::Contains("nested more than 2 levels deep"));
+}
+
+TEST_CASE("an unterminated quote in a response file is an error", "[response_files]") {
+  TempFile const file("name 'unterminated");
+  std::array args{"prog", file.at_path()};
+  CHECK_THROWS_WITH(CmdParser(cmd)(args), Catch::Contains("unterminated quote"));
+}
@@ -0,0 +1,87 @@
+#include <array>
+
+#include <fmt/format.h>
+
+#include <catch2/catch.hpp>
+
+#include "opzioni/cmd.hpp"
+
+using namespace opz;
+
+namespace {
+
+constexpr auto checkout = new_cmd("checkout").alias("co").pos<"branch">({});
+constexpr auto cherry_pick = new_cmd("cherry-pick").alias("pick").pos<"commit">({});
+constexpr auto commit = new_cmd("commit").opt<"message", "m">({});
+constexpr auto clone_cmd = new_cmd("clone").pos<"url">({});
+constexpr auto cl = new_cmd("cl");
+constexpr auto remove = new_cmd("remove").alias("rm");
+constexpr auto add = new_cmd("add");
+
+constexpr auto exact_cmd = new_cmd("git").sub(checkout).sub(cherry_pick).sub(commit);
+constexpr auto prefix_cmd =
+  new_cmd("git").with({.subcmd_prefixes = true}).sub(checkout).sub(cherry_pick).sub(commit).sub(clone_cmd).sub(cl);
+constexpr auto remove_cmd = new_cmd("x").with({.subcmd_prefixes = true}).sub(remove).sub(add);
+
+} // namespace
+
+TEST_CASE("subcommands are found by name and by alias", "[subcmds][aliases]") {
+  static_assert(exact_cmd.find_subcmd("checkout") == 0);
+  static_assert(exact_cmd.find_subcmd("co") == 0);
+  static_assert(exact_cmd.find_subcmd("pick") == 1);
+  static_assert(exact_cmd.find_subcmd("commit") == 2);
+  static_assert(exact_cmd.find_subcmd("com") == -1); // prefixes are off by default
+
+  std::array args{"git", "co", "main"};
+  auto const map = CmdParser(exact_cmd)(args);
+  auto const *const submap = map.get(checkout);
+  REQUIRE(submap != nullptr);
+  CHECK(submap->get<"branch">() == "main");
+}
+
+TEST_CASE("an unambiguous prefix finds its subcommand", "[subcmds][prefixes]") {
+  static_assert(prefix_cmd.find_subcmd("chec") == 0);
+  static_assert(prefix_cmd.find_subcmd("cherry") == 1);
+  static_assert(prefix_cmd.find_subcmd("com") == 2);
+  static_assert(prefix_cmd.find_subcmd("pi") == 1); // a prefix of an alias
+
+  std::array args{"git", "cherry", "abc123"};
+  auto const map = CmdParser(prefix_cmd)(args);
+  auto const *const submap = map.get(cherry_pick);
+  REQUIRE(submap != nullptr);
+  CHECK(submap->get<"commit">() == "abc123");
+}
+
+TEST_CASE("an ambiguous prefix finds no subcommand", "[subcmds][prefixes]") {
+  static_assert(prefix_cmd.find_subcmd("che") == -1);
+  static_assert(prefix_cmd.find_subcmd("c") == -1);
+  static_assert(prefix_cmd.find_subcmd("") == -1);
+
+  std::array args{"git", "che", "main"};
+  CHECK_THROWS_AS(CmdParser(prefix_cmd)(args), UserError);
+}
+
+TEST_CASE("the exact name of a subcommand wins over it being the prefix of another", "[subcmds][prefixes]") {
+  static_assert(prefix_cmd.find_subcmd("cl") == 4);
+  static_assert(prefix_cmd.find_subcmd("clo") == 3);
+
+  std::array args{"git", "cl"};
+  auto const map = CmdParser(prefix_cmd)(args);
+  CHECK(map.get(cl) != nullptr);
+  CHECK(map.get(clone_cmd) == nullptr);
+}
+
+TEST_CASE("a prefix of both the name and an alias of one subcommand is not ambiguous", "[subcmds][prefixes][aliases]") {
+  static_assert(remove_cmd.find_subcmd("r") == 0);
+  static_assert(remove_cmd.find_subcmd("rm") == 0);
+  static_assert(remove_cmd.find_subcmd("rem") == 0);
+}
+
+TEST_CASE("the usage line lists subcommands by name and the help lists their aliases too", "[subcmds][aliases]") {
+  fmt::memory_buffer usage, help;
+  CmdFmt const formatter(exact_cmd, ExtraInfo{});
+  formatter.format_usage(usage);
+  formatter.format_help(help);
+  CHECK_THAT(fmt::to_string(usage), Catch::Contains("{checkout, cherry-pick, commit}"));
+  CHECK_THAT(fmt::to_string(help), Catch::Contains("checkout, co") && Catch::Contains("cherry-pick, pick"));
+}